@@ -31,6 +31,15 @@
 
 #include "blinky.h"
 
+BlinkyState::BlinkyState() :
+    m_red(false),
+    m_yellow(false)
+{
+    for(int i=0; i<LED_COUNT; ++i) {
+        m_leds[i] = 0;
+    }
+}
+
 Blinky::Blinky(const char* blinkyDev) : m_blinkyDev(blinkyDev), m_blinkyfd(-1)
 {
     openBlinky();
@@ -47,10 +56,12 @@ void Blinky::openBlinky()
     m_blinkyfd = open(m_blinkyDev, O_RDWR | O_NOCTTY | O_NONBLOCK);
     if(m_blinkyfd < 0) {
         perror("open");
+        return;
     }
     if(!isatty(m_blinkyfd)) {
         fprintf(stderr, "%s is not a TTY!\n", m_blinkyDev);
         closeBlinky();
+        return;
     }
 
     /* Set up serial config goop */
@@ -58,6 +69,7 @@ void Blinky::openBlinky()
     if( tcgetattr(m_blinkyfd, &blinky_term) ) {
         perror("tcgetattr");
         closeBlinky();
+        return;
     }
     blinky_term.c_iflag = 0;
     blinky_term.c_oflag = 0;
@@ -68,6 +80,7 @@ void Blinky::openBlinky()
     if( tcsetattr(m_blinkyfd, TCSANOW, &blinky_term) ) {
         perror("tcsetatr");
         closeBlinky();
+        return;
     } 
     
     /* The TTY driver very helpfully sends DTR when you open the blinky device.
@@ -147,6 +160,17 @@ void Blinky::setYellow(bool on)
     }
 }
 
+void Blinky::show(const BlinkyState& state)
+{
+    /* Try to reopen a missing blinky once per call, not once per LED */
+    if( !ready() ) return;
+    for(int i=0; i<LED_COUNT; ++i) {
+        setLED(i, state.m_leds[i]);
+    }
+    setRed(state.m_red);
+    setYellow(state.m_yellow);
+}
+
 bool Blinky::ready()
 {
     // Is the blinky serial device open?
@@ -25,6 +25,16 @@
 
 #define LED_COUNT 6
 
+/* Everything the blinky can display */
+struct BlinkyState {
+    // Intensity of each PWM LED, in [0,1]
+    double m_leds[LED_COUNT];
+    bool m_red;
+    bool m_yellow;
+
+    BlinkyState();
+};
+
 class Blinky {
 private:
     const char* m_blinkyDev;
@@ -54,11 +64,16 @@ public:
     void setRed(bool on=true);
     // Turn the yellow 'debug' LED on or off
     void setYellow(bool on=true);
+    // Set every LED at once
+    void show(const BlinkyState& state);
 
     /* Check if the file is open, and if not, attempt to open it.  It will 
      * return false if the file is not open and could not be opened, and true 
      * if it is ready for writing */
     bool ready();
+    // Check if the file is open, without trying to reopen it
+    bool isOpen()
+        { return m_blinkyfd >= 0; }
     // Check if the connected device is actually the blinky
     bool isBlinky();
 };
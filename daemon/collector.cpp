@@ -0,0 +1,328 @@
+/******************************************************************************
+ * collector.cpp
+ * Copyright 2026 agent
+ *
+ * Reads every registered ProcSource once per tick, in as few syscalls as 
+ * the kernel allows.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+#include "collector.h"
+
+/* There's no liburing dependency; the handful of syscalls we need are simple
+ * enough to make directly. */
+static int io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete,
+                          unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, 
+                   NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void* arg,
+                             unsigned nrArgs)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+Collector::Collector() :
+    m_prepared(false),
+    m_ringfd(-1),
+    m_sqRing(MAP_FAILED),
+    m_sqRingSize(0),
+    m_cqRing(MAP_FAILED),
+    m_cqRingSize(0),
+    m_sqes((io_uring_sqe*)MAP_FAILED),
+    m_sqesSize(0)
+{ }
+
+Collector::~Collector()
+{
+    closeRing();
+    for(size_t i=0; i<m_entries.size(); ++i) {
+        close(m_entries[i].m_fd);
+    }
+}
+
+int Collector::add(ProcSource* source)
+{
+    int fd = open(source->path(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        perror(source->path());
+        return -1;
+    }
+
+    Entry entry;
+    entry.m_source = source;
+    entry.m_fd = fd;
+    entry.m_enabled = true;
+    entry.m_offset = 0;
+    entry.m_size = source->bufferSize();
+    m_entries.push_back(entry);
+
+    // The buffer layout and registered fd set are now stale
+    closeRing();
+    m_prepared = false;
+    return 0;
+}
+
+void Collector::setEnabled(ProcSource* source, bool enabled)
+{
+    for(size_t i=0; i<m_entries.size(); ++i) {
+        if(m_entries[i].m_source == source) {
+            m_entries[i].m_enabled = enabled;
+        }
+    }
+}
+
+void Collector::prepare()
+{
+    size_t total = 0;
+    for(size_t i=0; i<m_entries.size(); ++i) {
+        m_entries[i].m_offset = total;
+        total += m_entries[i].m_size + 1;
+    }
+    m_buffer.assign(total, '\0');
+
+    if(openRing()) {
+        closeRing();
+    }
+    m_prepared = true;
+}
+
+int Collector::openRing()
+{
+    if(m_entries.empty()) return -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_ringfd = io_uring_setup(m_entries.size(), &params);
+    if(m_ringfd < 0) {
+        // Old kernel, or io_uring disabled by sysctl / seccomp.
+        m_ringfd = -1;
+        return -1;
+    }
+
+    /* Map the submission and completion rings, and the SQE array */
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + 
+                   params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMmap && (m_cqRingSize > m_sqRingSize)) {
+        m_sqRingSize = m_cqRingSize;
+    }
+    m_sqRing = mmap(NULL, m_sqRingSize, PROT_READ | PROT_WRITE, 
+                    MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQ_RING);
+    if(m_sqRing == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    if(singleMmap) {
+        m_cqRing = m_sqRing;
+    } else {
+        m_cqRing = mmap(NULL, m_cqRingSize, PROT_READ | PROT_WRITE, 
+                        MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_CQ_RING);
+        if(m_cqRing == MAP_FAILED) {
+            perror("mmap");
+            return -1;
+        }
+    }
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = (io_uring_sqe*)mmap(NULL, m_sqesSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQES);
+    if(m_sqes == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    char* sq = (char*)m_sqRing;
+    m_sqHead = (unsigned*)(sq + params.sq_off.head);
+    m_sqTail = (unsigned*)(sq + params.sq_off.tail);
+    m_sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    m_sqArray = (unsigned*)(sq + params.sq_off.array);
+    char* cq = (char*)m_cqRing;
+    m_cqHead = (unsigned*)(cq + params.cq_off.head);
+    m_cqTail = (unsigned*)(cq + params.cq_off.tail);
+    m_cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    m_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    /* Register the fds and the buffer, so the kernel doesn't have to look
+     * them up and pin them again on every tick */
+    std::vector<int> fds(m_entries.size());
+    for(size_t i=0; i<m_entries.size(); ++i) {
+        fds[i] = m_entries[i].m_fd;
+    }
+    if(io_uring_register(m_ringfd, IORING_REGISTER_FILES, &fds[0], fds.size())) {
+        perror("IORING_REGISTER_FILES");
+        return -1;
+    }
+    struct iovec iov;
+    iov.iov_base = &m_buffer[0];
+    iov.iov_len = m_buffer.size();
+    if(io_uring_register(m_ringfd, IORING_REGISTER_BUFFERS, &iov, 1)) {
+        // Most likely RLIMIT_MEMLOCK.  preadv will do.
+        perror("IORING_REGISTER_BUFFERS");
+        return -1;
+    }
+
+    return 0;
+}
+
+void Collector::closeRing()
+{
+    if(m_sqes != MAP_FAILED) munmap(m_sqes, m_sqesSize);
+    if((m_cqRing != MAP_FAILED) && (m_cqRing != m_sqRing)) {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    if(m_sqRing != MAP_FAILED) munmap(m_sqRing, m_sqRingSize);
+    if(m_ringfd >= 0) close(m_ringfd);
+
+    m_sqes = (io_uring_sqe*)MAP_FAILED;
+    m_cqRing = MAP_FAILED;
+    m_sqRing = MAP_FAILED;
+    m_ringfd = -1;
+}
+
+int Collector::collect()
+{
+    if(!m_prepared) prepare();
+
+    if(usingRing()) {
+        return collectRing();
+    }
+
+    int ret = 0;
+    for(size_t i=0; i<m_entries.size(); ++i) {
+        if(!m_entries[i].m_enabled) continue;
+        if(dispatch(i, readEntry(i))) ret = -1;
+    }
+    return ret;
+}
+
+int Collector::collectRing()
+{
+    /* Queue one fixed-buffer read per source.  The ring was sized to the
+     * number of sources, and we always drain it, so there's always room. */
+    unsigned tail = *m_sqTail;
+    unsigned mask = *m_sqMask;
+    unsigned count = 0;
+    for(size_t i=0; i<m_entries.size(); ++i) {
+        if(!m_entries[i].m_enabled) continue;
+        unsigned idx = tail & mask;
+        struct io_uring_sqe* sqe = &m_sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = i;
+        sqe->off = 0;
+        sqe->addr = (unsigned long)&m_buffer[m_entries[i].m_offset];
+        sqe->len = m_entries[i].m_size;
+        sqe->buf_index = 0;
+        sqe->user_data = i;
+        m_sqArray[idx] = idx;
+        ++tail;
+        ++count;
+    }
+    if(count == 0) return 0;
+    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+    /* Submit everything and wait for all of it in one go */
+    int status;
+    do {
+        status = io_uring_enter(m_ringfd, count, count, IORING_ENTER_GETEVENTS);
+    } while( (status < 0) && (errno == EINTR) );
+    if(status < 0) {
+        perror("io_uring_enter");
+        closeRing();
+        return collect();
+    }
+
+    /* Hand each completion to its source's parser.  If we were interrupted
+     * after submitting, some completions may not be in yet, so keep waiting
+     * until they've all turned up. */
+    unsigned done = 0;
+    int ret = 0;
+    unsigned head = *m_cqHead;
+    while(done < count) {
+        unsigned cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        if(head == cqTail) {
+            do {
+                status = io_uring_enter(m_ringfd, 0, 1, IORING_ENTER_GETEVENTS);
+            } while( (status < 0) && (errno == EINTR) );
+            if(status < 0) {
+                perror("io_uring_enter");
+                break;
+            }
+            continue;
+        }
+        struct io_uring_cqe* cqe = &m_cqes[head & *m_cqMask];
+        size_t i = cqe->user_data;
+        long len = cqe->res;
+        if(len < 0) {
+            // Retry this one the slow way, in case the ring was the problem
+            len = readEntry(i);
+        }
+        if(dispatch(i, len)) ret = -1;
+        ++head;
+        ++done;
+    }
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+    if(done < count) {
+        // The ring is in an unknown state.  Stop using it.
+        closeRing();
+        return -1;
+    }
+    return ret;
+}
+
+long Collector::readEntry(size_t i)
+{
+    Entry& entry = m_entries[i];
+    struct iovec iov;
+    iov.iov_base = &m_buffer[entry.m_offset];
+    iov.iov_len = entry.m_size;
+    ssize_t len = preadv(entry.m_fd, &iov, 1, 0);
+    if(len < 0) {
+        perror(entry.m_source->path());
+        return -1;
+    }
+    return len;
+}
+
+int Collector::dispatch(size_t i, long len)
+{
+    if(len < 0) return -1;
+    Entry& entry = m_entries[i];
+    char* buf = &m_buffer[entry.m_offset];
+    buf[len] = '\0';
+    return entry.m_source->parse(buf, len);
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * collector.h
+ * Copyright 2026 agent
+ *
+ * Reads every registered ProcSource once per tick, in as few syscalls as 
+ * the kernel allows.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef COLLECTOR_H_
+#define COLLECTOR_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "procsource.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/* Batched reader for ProcSources.
+ * Each source's file is opened once, and gets a slice of one big buffer.
+ * Where io_uring is available, the fds and the buffer are registered with
+ * the kernel and every read for a tick goes out in a single io_uring_enter().
+ * Otherwise, we fall back to one preadv() per source. */
+class Collector {
+private:
+    struct Entry {
+        ProcSource* m_source;
+        int m_fd;
+        // Disabled sources stay registered, but aren't read
+        bool m_enabled;
+        // Offset of this source's slice of m_buffer, and its size
+        size_t m_offset;
+        size_t m_size;
+    };
+    std::vector<Entry> m_entries;
+    // Read buffers for all sources.  Each slice has room for a trailing NUL.
+    std::vector<char> m_buffer;
+    // Set once fds are registered and buffers are laid out
+    bool m_prepared;
+
+    /* io_uring state.  m_ringfd is -1 if we're using the preadv fallback. */
+    int m_ringfd;
+    void* m_sqRing;
+    size_t m_sqRingSize;
+    void* m_cqRing;
+    size_t m_cqRingSize;
+    io_uring_sqe* m_sqes;
+    size_t m_sqesSize;
+    unsigned* m_sqHead;
+    unsigned* m_sqTail;
+    unsigned* m_sqMask;
+    unsigned* m_sqArray;
+    unsigned* m_cqHead;
+    unsigned* m_cqTail;
+    unsigned* m_cqMask;
+    io_uring_cqe* m_cqes;
+
+    // Lay out buffers and (try to) set up the ring
+    void prepare();
+    /* Set up the io_uring and register fds and buffers with it.
+     * @return 0 on success, -1 if io_uring is unusable */
+    int openRing();
+    void closeRing();
+
+    // Read all sources through the ring.  @return 0 on success, -1 on failure
+    int collectRing();
+    // Read one source with preadv().  @return bytes read, or -1 on failure
+    long readEntry(size_t i);
+    // Terminate and parse a freshly read source.  @return 0 or -1
+    int dispatch(size_t i, long len);
+
+public:
+    Collector();
+    ~Collector();
+
+    /* Register a source to be read on every collect().  The source must
+     * outlive the collector.
+     * @return 0 on success, -1 if the source's file couldn't be opened */
+    int add(ProcSource* source);
+    /* Stop or resume reading a registered source.  Disabled sources cost
+     * nothing per tick. */
+    void setEnabled(ProcSource* source, bool enabled);
+
+    /* Read and parse every registered source.
+     * @return 0 if all sources updated, -1 if any of them failed */
+    int collect();
+
+    // Whether reads are going through io_uring (vs. the preadv fallback)
+    bool usingRing()
+        { return m_ringfd >= 0; }
+};
+
+#endif // COLLECTOR_H_
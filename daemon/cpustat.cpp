@@ -20,9 +20,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  *****************************************************************************/
 
-#include <string>
 #include <iostream>
-#include <fstream>
+#include <string.h>
+#include <unistd.h>
 
 #include "cpustat.h"
 #include "main.h"
@@ -76,6 +76,18 @@ CPUUtilization CPUUtilization::operator-(const CPUUtilization& other)
     return out;
 }
 
+CPUUtilization& CPUUtilization::operator+=(const CPUUtilization& other)
+{
+    m_user += other.m_user;
+    m_nice += other.m_nice;
+    m_system += other.m_system;
+    m_idle += other.m_idle;
+    m_iowait += other.m_iowait;
+    m_irq += other.m_irq;
+    m_softirq += other.m_softirq;
+    return *this;
+}
+
 double CPUUtilization::getUtilization()
 {
     double totalJiffies = getTotal();
@@ -90,64 +102,113 @@ ostream& operator<<(ostream& stream, const CPUUtilization& cpu)
     return stream;
 }
 
-int CPUStat::update() 
+/* Parse the seven jiffy counts following a cpu name in /proc/stat
+ * @return 0 on success, -1 if the line was short */
+static int parseJiffies(const char* p, CPUUtilization& cpu)
+{
+    // Skip the cpu name
+    while( (*p != ' ') && (*p != '\n') && (*p != '\0') ) ++p;
+
+    if( parseLong(p, cpu.m_user) ) return -1;
+    if( parseLong(p, cpu.m_nice) ) return -1;
+    if( parseLong(p, cpu.m_system) ) return -1;
+    if( parseLong(p, cpu.m_idle) ) return -1;
+    if( parseLong(p, cpu.m_iowait) ) return -1;
+    if( parseLong(p, cpu.m_irq) ) return -1;
+    if( parseLong(p, cpu.m_softirq) ) return -1;
+    return 0;
+}
+
+size_t CPUStat::bufferSize() const
 {
-    fstream procStat ("/proc/stat", ios_base::in);
+    /* Each cpu line is 10 counters of up to 20 digits, but in practice it's
+     * rare to see one over 100 characters. */
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if(cpus < 1) cpus = 1;
+    return 4096 + cpus * 256;
+}
 
+int CPUStat::parse(const char* buf, size_t)
+{
     /* Read the total cpu utilization data */
     CPUUtilization newTotal;
-    string cpuname;
-    procStat >> cpuname;  // (ignored)
-    procStat >> newTotal.m_user;
-    procStat >> newTotal.m_nice;
-    procStat >> newTotal.m_system;
-    procStat >> newTotal.m_idle;
-    procStat >> newTotal.m_iowait;
-    procStat >> newTotal.m_irq;
-    procStat >> newTotal.m_softirq;
-    clearLine(procStat);
-    if(procStat.fail()) {
+    const char* line = buf;
+    if( strncmp(line, "cpu ", 4) || parseJiffies(line, newTotal) ) {
         cerr << "Parse error reading total CPU utilization" << endl;
         return -1;
     }
 
     /* Update the total cpu utilization */
-    m_allCPUDiff = newTotal - m_allCPUTotal;
-    m_allCPUTotal = newTotal;
+    updateTotal(newTotal);
+    m_nodeDiffs.assign(m_nodeDiffs.size(), CPUUtilization());
 
     /* Read and update individual CPU utilization data */
     CPUUtilization curCpu;
     for(size_t i = 0; 1; ++i) {
         /* Read the cpu data */
-        procStat >> cpuname; // (ignored)
-        if( cpuname.find("cpu") == string::npos ) {
-            //First token in line doesn't contain 'cpu', we've read all cpu data
+        line = nextLine(line);
+        if( strncmp(line, "cpu", 3) ) {
+            //Line doesn't start with 'cpu', we've read all cpu data
             break;
         }
-        procStat >> curCpu.m_user; 
-        procStat >> curCpu.m_nice;
-        procStat >> curCpu.m_system;
-        procStat >> curCpu.m_idle;
-        procStat >> curCpu.m_iowait;
-        procStat >> curCpu.m_irq;
-        procStat >> curCpu.m_softirq;
-        clearLine(procStat);
-        if(procStat.fail()) {
+        if( parseJiffies(line, curCpu) ) {
             cerr << "Parse error reading CPU " << i << " utilization." << endl;
             break;
         }
+        const char* name = line + 3;
+        long id = i;
+        parseLong(name, id);
        
         /* Update the current cpu's data */
-        if( i >= m_cpuTotals.size() ) {
-            /* Haven't seen this cpu before. (Probably first run) */
-            m_cpuTotals.push_back(curCpu);
-            m_cpuDiffs.push_back(curCpu);
-        } else {
-            m_cpuDiffs[i] = curCpu - m_cpuTotals[i];
-            m_cpuTotals[i] = curCpu;
-        }
+        updateCPU(i, id, curCpu);
     }
 
     return 0;
 }
 
+void CPUStat::load(const CPUUtilization& total, 
+                   const vector<CPUUtilization>& cpus)
+{
+    updateTotal(total);
+    m_nodeDiffs.assign(m_nodeDiffs.size(), CPUUtilization());
+    for(size_t i=0; i<cpus.size(); ++i) {
+        updateCPU(i, i, cpus[i]);
+    }
+}
+
+void CPUStat::setTopology(const vector<int>& cpuNodes, int nodeCount)
+{
+    m_cpuNodes = cpuNodes;
+    m_nodeDiffs.assign(nodeCount, CPUUtilization());
+}
+
+void CPUStat::updateTotal(const CPUUtilization& total)
+{
+    m_allCPUDiff = CPUUtilization(total) - m_allCPUTotal;
+    m_allCPUTotal = total;
+}
+
+void CPUStat::updateCPU(size_t cpu, long id, const CPUUtilization& total)
+{
+    int node = -1;
+    if( (id >= 0) && ((size_t)id < m_cpuNodes.size()) ) {
+        node = m_cpuNodes[id];
+    }
+
+    if( cpu >= m_cpuTotals.size() ) {
+        /* Haven't seen this cpu before. (Probably first run) */
+        m_cpuTotals.push_back(total);
+        m_cpuDiffs.push_back(total);
+        m_indexNodes.push_back(node);
+    } else {
+        m_cpuDiffs[cpu] = CPUUtilization(total) - m_cpuTotals[cpu];
+        m_cpuTotals[cpu] = total;
+        m_indexNodes[cpu] = node;
+    }
+
+    /* Node totals are accumulated in the same pass, via the precomputed
+     * cpu -> node table */
+    if(node >= 0) {
+        m_nodeDiffs[node] += m_cpuDiffs[cpu];
+    }
+}
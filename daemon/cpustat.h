@@ -26,6 +26,8 @@
 #include <vector>
 #include <iostream>
 
+#include "procsource.h"
+
 /* Container for the various types of CPU jiffies accounted in
  * /proc/stat.  This class may store jiffies for a particular CPU,
  * or for all CPUs.  It may store total jiffies since startup,
@@ -44,6 +46,7 @@ public:
     CPUUtilization(const CPUUtilization& other);
     CPUUtilization& operator=(const CPUUtilization& other);
     CPUUtilization  operator-(const CPUUtilization& other);
+    CPUUtilization& operator+=(const CPUUtilization& other);
     friend std::ostream& operator<<(const CPUUtilization& cpu, std::ostream & stream);
 
     long getTotal() 
@@ -53,8 +56,8 @@ public:
 };
 
 /* Class for obtaining CPU utilization information from /proc/stat.
- * /proc/stat is read by calling the update() function.  */
-class CPUStat {
+ * /proc/stat is read by adding the CPUStat to a Collector.  */
+class CPUStat : public ProcSource {
 private:
     // The total utilization of all cpus since startup:
     CPUUtilization m_allCPUTotal;
@@ -66,13 +69,37 @@ private:
     // The change in each CPU's utilization between the last two updates
     std::vector<CPUUtilization> m_cpuDiffs;
 
+    // NUMA node index of each cpu id, or -1
+    std::vector<int> m_cpuNodes;
+    // The same, by index in /proc/stat order
+    std::vector<int> m_indexNodes;
+    // The change in each node's utilization between the last two updates
+    std::vector<CPUUtilization> m_nodeDiffs;
+
+    // Record new totals, and the diffs from the last ones
+    void updateTotal(const CPUUtilization& total);
+    /* @param cpu  index in /proc/stat order
+     * @param id   the kernel's cpu id, which skips offline cpus */
+    void updateCPU(size_t cpu, long id, const CPUUtilization& total);
+
 public:
-    /* Obtain new utilization info from /proc/stat
-     * Utilization diffs will be calculated from the data read on the
-     * last call to update().  (The first call to update() will give
-     * diffs relative to 0).
+    const char* path() const
+        { return "/proc/stat"; }
+    // Room for the cpu lines; the interrupt counts that follow are truncated
+    size_t bufferSize() const;
+    /* Parse new utilization info from the contents of /proc/stat
+     * Utilization diffs will be calculated from the data parsed on the
+     * last update.  (The first update will give diffs relative to 0).
      * @return  0 on success, -1 on failure */
-    int update();
+    int parse(const char* buf, size_t len);
+    /* Update with totals obtained some other way (e.g. a flight log replay),
+     * exactly as if they had been parsed from /proc/stat */
+    void load(const CPUUtilization& total, 
+              const std::vector<CPUUtilization>& cpus);
+
+    /* Also sum the per-CPU diffs into per-node diffs, on every update.
+     * @param cpuNodes  node index of each cpu id, as from NumaTopology */
+    void setTopology(const std::vector<int>& cpuNodes, int nodeCount);
 
     int cpuCount()
         { return m_cpuTotals.size(); }
@@ -89,6 +116,16 @@ public:
     // Change in utilization for a particualr CPU between last two updates
     CPUUtilization& cpuDiff(int cpu)
         { return m_cpuDiffs[cpu]; }
+
+    // Number of NUMA nodes, or 0 if setTopology() wasn't called
+    int nodeCount()
+        { return m_nodeDiffs.size(); }
+    // NUMA node index of a particular CPU, or -1 if unknown
+    int cpuNode(int cpu)
+        { return m_indexNodes[cpu]; }
+    // Change in utilization for all CPUs of a node between last two updates
+    CPUUtilization& nodeDiff(int node)
+        { return m_nodeDiffs[node]; }
 };
 
 #endif //CPUSTAT_H_
@@ -0,0 +1,703 @@
+/******************************************************************************
+ * flightlog.cpp
+ * Copyright 2026 agent
+ *
+ * Compact binary log of raw readings and LED outputs, for recording and 
+ * later replay.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "flightlog.h"
+
+/* File layout:
+ *   "SLFR" <version byte>
+ *   records: <varint body length> <body>
+ *
+ * Record body:
+ *   varint  flags (FLAG_*)
+ *   varint  time: absolute ms in a keyframe, else ms since the last record
+ *   varint  cpu count, n
+ *   keyframes only:
+ *     varint    NUMA node count, m
+ *     n varints node index + 1 of each cpu (0 for none), only if m > 0
+ *     varint    CPU package count
+ *   n+1 utilization changes, for the total and then each cpu.  Each is the
+ *       tick's busy fraction scaled to [0,255], minus the previous tick's,
+ *       mod 256.  They are packed in runs: a byte h < 0x80 is followed by 
+ *       h+1 literal changes, and a byte h >= 0x80 by one change repeated
+ *       h-0x80+2 times, so idle or steady CPUs cost almost nothing.
+ *   4 zigzag varints  change in MemTotal, MemFree, Buffers, Cached
+ *   4 zigzag varints  event deltas (only if FLAG_EVENTS)
+ *   LED_COUNT bytes   LED intensities, scaled to [0,255]
+ *   byte    bit 0: red, bit 1: yellow
+ *
+ * In a keyframe, all previous values are taken to be zero.
+ *
+ * Jiffy-exact per-CPU counters can't be made small enough: with 10 jiffy
+ * ticks and random user/system/idle splits they came to 640-900 bytes a
+ * tick for 256 CPUs, or 550-780 MB a day at 10 Hz.  With one byte of 
+ * utilization per CPU, the same load is about 280 bytes a tick (240 MB a
+ * day at 10 Hz, 50 MB at the daemon's 2 Hz), and idle or steady CPUs are
+ * about 26 bytes a tick (22 MB a day at 10 Hz).  Random per-CPU load is
+ * the worst case, and still misses tens of MB a day at 10 Hz. */
+static const char MAGIC[4] = { 'S', 'L', 'F', 'R' };
+#define VERSION 3
+
+#define FLAG_KEYFRAME 0x1
+#define FLAG_EVENTS   0x2
+
+#define HEADER_SIZE (sizeof(MAGIC) + 1)
+
+// Hand the write buffer to the writer once it has this much in it
+#define FLUSH_SIZE (32 * 1024)
+// Drop samples if this much is waiting on a stuck writer
+#define MAX_BACKLOG (1024 * 1024)
+#define WRITER_STACK_SIZE (64 * 1024)
+// m_rotateAt when no rotation is due
+#define NO_ROTATE ((size_t)-1)
+
+// Longest run of literal or repeated changes in one packed run
+#define MAX_LITERALS 128
+#define MAX_REPEATS 129
+// Shortest repeat worth packing as a run
+#define MIN_REPEATS 3
+
+// Most cpus a log can describe; the kernel's own NR_CPUS limit
+#define MAX_LOG_CPUS 8192
+// Longest a varint can be
+#define MAX_VARINT 10
+
+/* The largest record body which can describe this many cpus: the header
+ * and keyframe varints, every change as a literal, and the memory, event 
+ * and LED fields. */
+static size_t maxRecordSize(size_t cpus)
+{
+    size_t changes = cpus + 1;
+    size_t packed = changes + (changes + MAX_LITERALS - 1) / MAX_LITERALS;
+    size_t keyframe = (cpus + 2) * MAX_VARINT;
+    return 3 * MAX_VARINT + keyframe + packed + 8 * MAX_VARINT + LED_COUNT + 1;
+}
+
+static void putVarint(std::vector<unsigned char>& out, unsigned long long val)
+{
+    while(val >= 0x80) {
+        out.push_back( (val & 0x7f) | 0x80 );
+        val >>= 7;
+    }
+    out.push_back(val);
+}
+
+static void putSigned(std::vector<unsigned char>& out, long long val)
+{
+    // Zigzag, so small negative numbers are small too
+    putVarint(out, ((unsigned long long)val << 1) ^ (val >> 63));
+}
+
+/* Read a varint, advancing p.
+ * @return 0 on success, -1 if it runs past end */
+static int getVarint(const unsigned char*& p, const unsigned char* end,
+                     unsigned long long& val)
+{
+    val = 0;
+    for(int shift = 0; (p < end) && (shift < 64); shift += 7) {
+        unsigned char byte = *p++;
+        val |= (unsigned long long)(byte & 0x7f) << shift;
+        if( !(byte & 0x80) ) return 0;
+    }
+    return -1;
+}
+
+static int getSigned(const unsigned char*& p, const unsigned char* end,
+                     long long& val)
+{
+    unsigned long long raw;
+    if( getVarint(p, end, raw) ) return -1;
+    val = (long long)(raw >> 1) ^ -(long long)(raw & 1);
+    return 0;
+}
+
+FlightSample::FlightSample() :
+    m_time(0),
+    m_memTotal(0),
+    m_memFree(0),
+    m_memBuffers(0),
+    m_memCached(0),
+    m_hasEvents(false),
+    m_nodeCount(0),
+    m_packageCount(0)
+{ }
+
+void FlightCoder::reset(size_t cpuCount)
+{
+    m_prevTotals.assign(cpuCount + 1, CPUUtilization());
+    m_prevUtil.assign(cpuCount + 1, 0);
+    m_changes.resize(cpuCount + 1);
+    m_prevTime = 0;
+    for(int i=0; i<4; ++i) {
+        m_prevMem[i] = 0;
+    }
+    m_nodeCount = 0;
+    m_packageCount = 0;
+    m_cpuNodes.assign(cpuCount, -1);
+}
+
+// How many of the changes starting at i repeat the first, up to MAX_REPEATS
+static size_t repeats(const std::vector<unsigned char>& changes, size_t i)
+{
+    size_t run = 1;
+    while( (i + run < changes.size()) && (run < MAX_REPEATS) &&
+           (changes[i + run] == changes[i]) ) {
+        ++run;
+    }
+    return run;
+}
+
+FlightRecorder::FlightRecorder(const char* path, size_t maxBytes) :
+    m_path(path),
+    m_oldPath(std::string(path) + ".1"),
+    m_maxBytes(maxBytes),
+    m_fd(-1),
+    m_fileSize(0),
+    m_fileBytes(0),
+    m_needKeyframe(true),
+    m_failing(false),
+    m_handedOff(false),
+    m_rotateAt(NO_ROTATE),
+    m_threadStarted(false),
+    m_writing(false),
+    m_stopping(false),
+    m_pendingRotateAt(NO_ROTATE),
+    m_chunkFailed(false),
+    m_writeErrno(0),
+    m_fileLost(false),
+    m_goodBytes(0)
+{
+    m_buf.reserve(2 * FLUSH_SIZE);
+    m_pending.reserve(2 * FLUSH_SIZE);
+    pthread_mutex_init(&m_lock, NULL);
+    pthread_cond_init(&m_wake, NULL);
+    pthread_cond_init(&m_idle, NULL);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    if(m_threadStarted) {
+        flush();
+        pthread_mutex_lock(&m_lock);
+        m_stopping = true;
+        pthread_cond_signal(&m_wake);
+        pthread_mutex_unlock(&m_lock);
+        pthread_join(m_thread, NULL);
+    }
+    if(m_fd >= 0) close(m_fd);
+    pthread_cond_destroy(&m_idle);
+    pthread_cond_destroy(&m_wake);
+    pthread_mutex_destroy(&m_lock);
+}
+
+int FlightRecorder::open()
+{
+    if( openFile() ) return -1;
+    m_fileBytes = m_goodBytes = m_fileSize;
+    m_needKeyframe = true;
+
+    /* Signals are for the main loop, so the writer blocks them all.  It
+     * only ever needs a little stack. */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, WRITER_STACK_SIZE);
+    int err = pthread_create(&m_thread, &attr, writerMain, this);
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if(err) {
+        fprintf(stderr, "Failed to start flight log writer: %s\n", 
+                strerror(err));
+        return -1;
+    }
+    m_threadStarted = true;
+    return 0;
+}
+
+/* Only ever called when nothing worth keeping is at m_path: at open(), or
+ * once the old file has been renamed away. */
+int FlightRecorder::openFile()
+{
+    m_fd = ::open(m_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(m_fd < 0) {
+        perror(m_path);
+        return -1;
+    }
+    m_fileSize = 0;
+
+    unsigned char header[HEADER_SIZE];
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    header[sizeof(MAGIC)] = VERSION;
+    int err = writeRecords(header, sizeof(header));
+    if(err) {
+        // Records without a header would be unreadable
+        fprintf(stderr, "%s: %s\n", m_path, strerror(err));
+        if(m_fd >= 0) close(m_fd);
+        m_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int FlightRecorder::rotate()
+{
+    /* Keep the previous file as <path>.1.  If that can't be done, carry on
+     * appending to it rather than truncating it.  With no file open, 
+     * whatever is left at path is moved aside the same way. */
+    if( rename(m_path, m_oldPath.c_str()) && 
+        ((m_fd >= 0) || (errno != ENOENT)) ) {
+        perror("rename");
+        return -1;
+    }
+    if(m_fd >= 0) close(m_fd);
+    m_fd = -1;
+    return openFile();
+}
+
+int FlightRecorder::writeAll(const unsigned char* data, size_t len)
+{
+    if(m_fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+    size_t done = 0;
+    while(done < len) {
+        ssize_t written = write(m_fd, data + done, len - done);
+        if(written < 0) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        done += written;
+    }
+    return 0;
+}
+
+int FlightRecorder::writeRecords(const unsigned char* data, size_t len)
+{
+    if( writeAll(data, len) == 0 ) {
+        m_fileSize += len;
+        return 0;
+    }
+
+    int err = errno;
+    if( (m_fd >= 0) && 
+        (ftruncate(m_fd, m_fileSize) || 
+         (lseek(m_fd, m_fileSize, SEEK_SET) < 0)) ) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    return err;
+}
+
+void FlightRecorder::reportFailure(int err)
+{
+    if(m_failing) return;
+    fprintf(stderr, "Flight log write failed: %s.  Samples are dropped until "
+            "it recovers.\n", strerror(err));
+    m_failing = true;
+}
+
+bool FlightRecorder::handOff(bool wait)
+{
+    pthread_mutex_lock(&m_lock);
+    while(wait && m_writing) {
+        pthread_cond_wait(&m_idle, &m_lock);
+    }
+    if(m_writing) {
+        pthread_mutex_unlock(&m_lock);
+        return false;
+    }
+
+    if(m_chunkFailed) {
+        m_chunkFailed = false;
+        int err = m_writeErrno;
+        bool lost = m_fileLost;
+        m_fileBytes = m_goodBytes;
+        pthread_mutex_unlock(&m_lock);
+
+        reportFailure(err);
+        m_handedOff = false;
+        /* Start again from a keyframe.  A lost file is reopened on the way
+         * into the next chunk. */
+        m_buf.clear();
+        m_rotateAt = lost ? 0 : NO_ROTATE;
+        m_needKeyframe = true;
+        return false;
+    }
+    if(m_failing && m_handedOff) {
+        fprintf(stderr, "Flight log writes recovered.\n");
+        m_failing = false;
+    }
+
+    /* The writer left m_pending empty, so this swaps in a cleared buffer 
+     * with its capacity intact */
+    m_pending.swap(m_buf);
+    m_pendingRotateAt = m_rotateAt;
+    if(m_rotateAt != NO_ROTATE) {
+        m_fileBytes = HEADER_SIZE + m_pending.size() - m_rotateAt;
+    } else {
+        // From the writer's count, in case a rotation was skipped
+        m_fileBytes = m_goodBytes + m_pending.size();
+    }
+    m_rotateAt = NO_ROTATE;
+    m_writing = true;
+    m_handedOff = true;
+    pthread_cond_signal(&m_wake);
+    pthread_mutex_unlock(&m_lock);
+    return true;
+}
+
+void* FlightRecorder::writerMain(void* recorder)
+{
+    ((FlightRecorder*)recorder)->writer();
+    return NULL;
+}
+
+void FlightRecorder::writer()
+{
+    pthread_mutex_lock(&m_lock);
+    for(;;) {
+        while( !m_writing && !m_stopping ) {
+            pthread_cond_wait(&m_wake, &m_lock);
+        }
+        if( !m_writing ) break;
+        pthread_mutex_unlock(&m_lock);
+
+        /* Records up to the rotation point finish the old file, and the
+         * rest (starting with a keyframe) begin the new one.  A skipped
+         * rotation just leaves the keyframe in the old file. */
+        size_t split = m_pending.size();
+        if(m_pendingRotateAt < split) split = m_pendingRotateAt;
+        int err = 0;
+        if(split) err = writeRecords(&m_pending[0], split);
+        if( !err && (m_pendingRotateAt != NO_ROTATE) ) rotate();
+        if( !err && (split < m_pending.size()) ) {
+            err = writeRecords(&m_pending[split], m_pending.size() - split);
+        }
+
+        pthread_mutex_lock(&m_lock);
+        m_pending.clear();
+        m_writing = false;
+        m_chunkFailed = (err != 0);
+        if(err) m_writeErrno = err;
+        m_fileLost = (m_fd < 0);
+        m_goodBytes = m_fileSize;
+        pthread_cond_broadcast(&m_idle);
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+int FlightRecorder::flush()
+{
+    if( !m_threadStarted ) return -1;
+
+    if( !m_buf.empty() ) handOff(true);
+
+    pthread_mutex_lock(&m_lock);
+    while(m_writing) {
+        pthread_cond_wait(&m_idle, &m_lock);
+    }
+    bool failed = m_chunkFailed;
+    int err = m_writeErrno;
+    pthread_mutex_unlock(&m_lock);
+
+    if(failed) reportFailure(err);
+    return failed ? -1 : 0;
+}
+
+int FlightRecorder::record(const FlightSample& sample)
+{
+    if( !m_threadStarted ) return -1;
+    if(sample.m_cpus.size() > MAX_LOG_CPUS) return -1;
+    // The writer is stuck; drop samples rather than growing without bound
+    if(m_buf.size() >= MAX_BACKLOG) return -1;
+
+    if( (m_rotateAt == NO_ROTATE) && 
+        (m_fileBytes + m_buf.size() >= m_maxBytes / 2) ) {
+        m_rotateAt = m_buf.size();
+        m_needKeyframe = true;
+    }
+    if(m_prevTotals.size() != sample.m_cpus.size() + 1) {
+        m_needKeyframe = true;
+    }
+
+    encode(sample, m_needKeyframe);
+    m_needKeyframe = false;
+    putVarint(m_buf, m_record.size());
+    m_buf.insert(m_buf.end(), m_record.begin(), m_record.end());
+
+    /* If the writer's still busy with the last chunk, just keep buffering
+     * and try again next tick */
+    if(m_buf.size() >= FLUSH_SIZE) {
+        handOff(false);
+    }
+    return 0;
+}
+
+void FlightRecorder::encode(const FlightSample& sample, bool keyframe)
+{
+    size_t cpus = sample.m_cpus.size();
+    if(keyframe) reset(cpus);
+    m_record.clear();
+
+    unsigned flags = 0;
+    if(keyframe) flags |= FLAG_KEYFRAME;
+    if(sample.m_hasEvents) flags |= FLAG_EVENTS;
+    putVarint(m_record, flags);
+    putVarint(m_record, sample.m_time - m_prevTime);
+    m_prevTime = sample.m_time;
+    putVarint(m_record, cpus);
+    if(keyframe) {
+        putVarint(m_record, sample.m_nodeCount);
+        for(size_t i=0; (sample.m_nodeCount > 0) && (i<cpus); ++i) {
+            int node = -1;
+            if(i < sample.m_cpuNodes.size()) node = sample.m_cpuNodes[i];
+            putVarint(m_record, node + 1);
+        }
+        putVarint(m_record, sample.m_packageCount);
+    }
+
+    /* Quantize each entry's utilization over the tick */
+    for(size_t i=0; i<=cpus; ++i) {
+        const CPUUtilization& cur = i ? sample.m_cpus[i-1] : sample.m_total;
+        CPUUtilization delta = CPUUtilization(cur) - m_prevTotals[i];
+        long total = delta.getTotal();
+        unsigned char util = m_prevUtil[i];
+        if(total > 0) {
+            long busy = total - delta.m_idle;
+            if(busy < 0) busy = 0;
+            if(busy > total) busy = total;
+            util = (busy * 255 + total / 2) / total;
+        }
+        m_changes[i] = util - m_prevUtil[i];
+        m_prevUtil[i] = util;
+        m_prevTotals[i] = cur;
+    }
+
+    /* Pack them into runs */
+    for(size_t i=0; i<=cpus; ) {
+        size_t run = repeats(m_changes, i);
+        if(run >= MIN_REPEATS) {
+            m_record.push_back(0x80 + run - 2);
+            m_record.push_back(m_changes[i]);
+            i += run;
+            continue;
+        }
+        size_t count = run;
+        while( (i + count <= cpus) && (count < MAX_LITERALS) &&
+               (repeats(m_changes, i + count) < MIN_REPEATS) ) {
+            ++count;
+        }
+        m_record.push_back(count - 1);
+        m_record.insert(m_record.end(), m_changes.begin() + i, 
+                        m_changes.begin() + i + count);
+        i += count;
+    }
+
+    long mem[4] = { sample.m_memTotal, sample.m_memFree, 
+                    sample.m_memBuffers, sample.m_memCached };
+    for(int i=0; i<4; ++i) {
+        putSigned(m_record, mem[i] - m_prevMem[i]);
+        m_prevMem[i] = mem[i];
+    }
+
+    if(sample.m_hasEvents) {
+        putSigned(m_record, sample.m_events.m_contextSwitches);
+        putSigned(m_record, sample.m_events.m_migrations);
+        putSigned(m_record, sample.m_events.m_faults);
+        putSigned(m_record, sample.m_events.m_majorFaults);
+    }
+
+    for(int i=0; i<LED_COUNT; ++i) {
+        double led = sample.m_outputs.m_leds[i];
+        if( !(led > 0) ) led = 0;  // (also catches NaN)
+        if(led > 1) led = 1;
+        m_record.push_back( (unsigned char)lround(led * 255) );
+    }
+    m_record.push_back( (sample.m_outputs.m_red ? 1 : 0) | 
+                        (sample.m_outputs.m_yellow ? 2 : 0) );
+}
+
+FlightReplayer::FlightReplayer(const char* path) :
+    m_path(path),
+    m_file(NULL)
+{ }
+
+FlightReplayer::~FlightReplayer()
+{
+    if(m_file) fclose(m_file);
+}
+
+int FlightReplayer::open()
+{
+    m_file = fopen(m_path, "rb");
+    if(!m_file) {
+        perror(m_path);
+        return -1;
+    }
+
+    char header[sizeof(MAGIC) + 1];
+    if( (fread(header, 1, sizeof(header), m_file) != sizeof(header)) ||
+        memcmp(header, MAGIC, sizeof(MAGIC)) ) {
+        fprintf(stderr, "%s is not a flight log\n", m_path);
+        return -1;
+    }
+    if(header[sizeof(MAGIC)] != VERSION) {
+        fprintf(stderr, "%s has unsupported version %d\n", m_path, 
+                header[sizeof(MAGIC)]);
+        return -1;
+    }
+    return 0;
+}
+
+int FlightReplayer::next(FlightSample& sample)
+{
+    /* Read the record length */
+    unsigned long long len = 0;
+    for(int shift = 0; ; shift += 7) {
+        int byte = getc(m_file);
+        if(byte == EOF) {
+            if(shift) fprintf(stderr, "Truncated record at end of log\n");
+            return 0;
+        }
+        if(shift >= 64) return -1;
+        len |= (unsigned long long)(byte & 0x7f) << shift;
+        if( !(byte & 0x80) ) break;
+    }
+
+    if( (len == 0) || (len > maxRecordSize(MAX_LOG_CPUS)) ) {
+        fprintf(stderr, "Corrupt record length %llu\n", len);
+        return -1;
+    }
+    m_record.resize(len);
+    if(fread(&m_record[0], 1, len, m_file) != len) {
+        // Normal if the recorder was killed mid-write
+        fprintf(stderr, "Truncated record at end of log\n");
+        return 0;
+    }
+
+    return decode(sample) ? -1 : 1;
+}
+
+int FlightReplayer::decode(FlightSample& sample)
+{
+    const unsigned char* p = &m_record[0];
+    const unsigned char* end = p + m_record.size();
+    unsigned long long flags, time, cpus;
+    long long val;
+
+    if( getVarint(p, end, flags) ) return -1;
+    if( getVarint(p, end, time) ) return -1;
+    if( getVarint(p, end, cpus) ) return -1;
+    if(cpus > MAX_LOG_CPUS) return -1;
+    if(flags & FLAG_KEYFRAME) {
+        reset(cpus);
+        unsigned long long nodes, node, packages;
+        if( getVarint(p, end, nodes) || (nodes > MAX_LOG_CPUS) ) return -1;
+        m_nodeCount = nodes;
+        for(size_t i=0; (nodes > 0) && (i<cpus); ++i) {
+            if( getVarint(p, end, node) || (node > nodes) ) return -1;
+            m_cpuNodes[i] = (int)node - 1;
+        }
+        if( getVarint(p, end, packages) || (packages > MAX_LOG_CPUS) ) {
+            return -1;
+        }
+        m_packageCount = packages;
+    } else if(m_prevTotals.size() != cpus + 1) {
+        // No keyframe seen yet, or the cpu count changed without one
+        return -1;
+    }
+    sample.m_nodeCount = m_nodeCount;
+    sample.m_packageCount = m_packageCount;
+    sample.m_cpuNodes = m_cpuNodes;
+
+    m_prevTime += time;
+    sample.m_time = m_prevTime;
+    sample.m_cpus.resize(cpus);
+
+    for(size_t i=0; i<=cpus; ) {
+        if(p >= end) return -1;
+        unsigned char header = *p++;
+        size_t count;
+        bool repeat = header & 0x80;
+        if(repeat) {
+            count = header - 0x80 + 2;
+        } else {
+            count = header + 1;
+        }
+        if( (i + count > cpus + 1) || (end - p < (repeat ? 1 : (long)count)) ) {
+            return -1;
+        }
+        for(size_t j=i; j<i+count; ++j) {
+            unsigned char change = repeat ? *p : p[j - i];
+            m_prevUtil[j] += change;
+
+            /* Synthesize totals which give the same utilization */
+            CPUUtilization& cur = j ? sample.m_cpus[j-1] : sample.m_total;
+            cur = m_prevTotals[j];
+            cur.m_user += m_prevUtil[j];
+            cur.m_idle += 255 - m_prevUtil[j];
+            m_prevTotals[j] = cur;
+        }
+        p += repeat ? 1 : count;
+        i += count;
+    }
+
+    long* mem[4] = { &sample.m_memTotal, &sample.m_memFree, 
+                     &sample.m_memBuffers, &sample.m_memCached };
+    for(int i=0; i<4; ++i) {
+        if( getSigned(p, end, val) ) return -1;
+        m_prevMem[i] += val;
+        *mem[i] = m_prevMem[i];
+    }
+
+    sample.m_hasEvents = flags & FLAG_EVENTS;
+    if(sample.m_hasEvents) {
+        long* events[4] = { &sample.m_events.m_contextSwitches,
+                            &sample.m_events.m_migrations,
+                            &sample.m_events.m_faults,
+                            &sample.m_events.m_majorFaults };
+        for(int i=0; i<4; ++i) {
+            if( getSigned(p, end, val) ) return -1;
+            *events[i] = val;
+        }
+    }
+
+    if(end - p < LED_COUNT + 1) return -1;
+    for(int i=0; i<LED_COUNT; ++i) {
+        sample.m_outputs.m_leds[i] = *p++ / 255.0;
+    }
+    sample.m_outputs.m_red = *p & 1;
+    sample.m_outputs.m_yellow = *p & 2;
+    return 0;
+}
@@ -0,0 +1,204 @@
+/******************************************************************************
+ * flightlog.h
+ * Copyright 2026 agent
+ *
+ * Compact binary log of raw readings and LED outputs, for recording and 
+ * later replay.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef FLIGHTLOG_H_
+#define FLIGHTLOG_H_
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "blinky.h"
+#include "cpustat.h"
+#include "perfstat.h"
+
+/* Everything recorded for one tick */
+struct FlightSample {
+    // Monotonic time of the sample, in ms
+    long long m_time;
+    /* Jiffy totals since boot, as in CPUStat::total() and CPUStat::cpu().
+     * Only each tick's utilization is logged, so replayed samples carry
+     * synthetic totals which advance by 255 jiffies a tick and reproduce
+     * the recorded utilization to within 1/255. */
+    CPUUtilization m_total;
+    std::vector<CPUUtilization> m_cpus;
+    // Memory fields, as in Meminfo
+    long m_memTotal;
+    long m_memFree;
+    long m_memBuffers;
+    long m_memCached;
+    // Event deltas over the tick, if m_hasEvents
+    bool m_hasEvents;
+    PerfCounts m_events;
+    // What was displayed, LED intensities quantized to 8 bits
+    BlinkyState m_outputs;
+    /* The NUMA node of each cpu (only if m_nodeCount is non-zero), and the 
+     * node and CPU package counts the LED rules were checked against.
+     * These are only logged in keyframes. */
+    int m_nodeCount;
+    int m_packageCount;
+    std::vector<int> m_cpuNodes;
+
+    FlightSample();
+};
+
+/* Delta coding state, shared by the writer and reader.
+ * Each CPU's utilization over the tick is quantized to a byte and stored
+ * as the change from its previous tick, which is zero for a CPU with 
+ * steady load, and runs of equal changes are collapsed. */
+class FlightCoder {
+protected:
+    // Previous totals and utilization bytes, for the total then each cpu
+    std::vector<CPUUtilization> m_prevTotals;
+    std::vector<unsigned char> m_prevUtil;
+    long long m_prevTime;
+    long m_prevMem[4];
+    // Topology from the last keyframe
+    int m_nodeCount;
+    int m_packageCount;
+    std::vector<int> m_cpuNodes;
+    // Scratch space for one sample's utilization changes
+    std::vector<unsigned char> m_changes;
+
+    // Forget all history; the next sample is coded as a keyframe
+    void reset(size_t cpuCount);
+};
+
+/* Appends samples to a size capped log file.  When the file reaches half 
+ * the cap, it's moved to <path>.1 (replacing any older one) and a new file
+ * is started, so the two files never exceed the cap together.  Each file 
+ * begins with a keyframe and can be replayed on its own.
+ *
+ * Records are encoded into a memory buffer, which is handed to a writer
+ * thread in large chunks.  All the file IO, rotation included, happens on
+ * that thread, so recording a tick never makes a syscall that touches the
+ * disk.
+ *
+ * If a write fails, the file is cut back to its last whole record, the
+ * records coded since are dropped, and recording resumes with a keyframe.
+ * If the file can't be kept at all, it's moved aside and reopened on the
+ * next chunk.  A rotation whose rename fails is skipped, rather than 
+ * truncating the file it couldn't keep. */
+class FlightRecorder : private FlightCoder {
+private:
+    const char* m_path;
+    std::string m_oldPath;
+    size_t m_maxBytes;
+    // Only touched by the writer thread once it's started
+    int m_fd;
+    // Bytes of whole records in the current file.  Writer only.
+    size_t m_fileSize;
+    // Bytes handed to the writer for the current file
+    size_t m_fileBytes;
+    bool m_needKeyframe;
+    // Whether writes are failing, and a chunk has gone out since they began
+    bool m_failing;
+    bool m_handedOff;
+    // Encoded records not yet handed to the writer
+    std::vector<unsigned char> m_buf;
+    // Offset in m_buf where a new file must begin, or NO_ROTATE if none
+    size_t m_rotateAt;
+    // Scratch space for the record being encoded
+    std::vector<unsigned char> m_record;
+
+    /* Writer thread state.  m_pending and m_pendingRotateAt belong to the 
+     * writer while m_writing is set, and everything else here is guarded
+     * by m_lock. */
+    pthread_t m_thread;
+    bool m_threadStarted;
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_wake;
+    pthread_cond_t m_idle;
+    bool m_writing;
+    bool m_stopping;
+    std::vector<unsigned char> m_pending;
+    size_t m_pendingRotateAt;
+    // How the last chunk went: whether it failed and why, whether the 
+    // file is gone, and m_fileSize after it
+    bool m_chunkFailed;
+    int m_writeErrno;
+    bool m_fileLost;
+    size_t m_goodBytes;
+
+    int openFile();
+    int rotate();
+    // @return 0 on success, -1 with errno set on failure
+    int writeAll(const unsigned char* data, size_t len);
+    /* Append part of a chunk.  On failure, cut the file back to its last
+     * whole record, or give it up if that fails too.
+     * @return 0 on success, or the errno of the failure */
+    int writeRecords(const unsigned char* data, size_t len);
+    /* Hand m_buf to the writer, waiting for it to be free if wait is set.
+     * If the writer's last chunk failed, m_buf is dropped instead, since 
+     * it was coded against records the file never got.
+     * @return true if m_buf was handed off */
+    bool handOff(bool wait);
+    // Log a write failure, once per run of them
+    void reportFailure(int err);
+    static void* writerMain(void* recorder);
+    void writer();
+    // Encode one sample into m_record
+    void encode(const FlightSample& sample, bool keyframe);
+
+public:
+    FlightRecorder(const char* path, size_t maxBytes);
+    ~FlightRecorder();
+
+    /* Start a new log, replacing any existing one at path, and start the
+     * writer thread.
+     * @return 0 on success, -1 on failure */
+    int open();
+    /* Append a sample.  It may not reach disk until the buffer fills or
+     * flush() is called.
+     * @return 0 on success, -1 if the sample was dropped */
+    int record(const FlightSample& sample);
+    /* Write out all buffered samples, waiting until they're on disk.
+     * @return 0 on success, -1 on failure */
+    int flush();
+};
+
+/* Reads samples back from a log written by FlightRecorder */
+class FlightReplayer : private FlightCoder {
+private:
+    const char* m_path;
+    FILE* m_file;
+    // The record being decoded
+    std::vector<unsigned char> m_record;
+
+    // Decode m_record into sample.  @return 0 on success, -1 if corrupt
+    int decode(FlightSample& sample);
+
+public:
+    FlightReplayer(const char* path);
+    ~FlightReplayer();
+
+    /* Open the log and check its header.
+     * @return 0 on success, -1 on failure */
+    int open();
+    /* Read the next sample.
+     * @return 1 on success, 0 at end of log, -1 on a corrupt record */
+    int next(FlightSample& sample);
+};
+
+#endif // FLIGHTLOG_H_
@@ -0,0 +1,68 @@
+/******************************************************************************
+ * footprint.h
+ * Copyright 2026 agent
+ *
+ * Keeps the daemon's own resource usage down, and measures it.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef FOOTPRINT_H_
+#define FOOTPRINT_H_
+
+#include <time.h>
+
+/* The budget the self-check holds the daemon to */
+#define BUDGET_RSS_KB 8192
+#define BUDGET_ALLOCS_PER_TICK 0
+#define BUDGET_CPU_SECONDS_PER_HOUR 3.6  // 0.1% of one core
+
+/* Make the daemon as unobtrusive as possible: run it under SCHED_IDLE, let
+ * the kernel batch its timer wakeups, and lock its pages in memory so 
+ * sampling never waits on a page fault.  Each step is best effort; 
+ * failures are reported and skipped.
+ * NB: Under SCHED_IDLE, the LEDs may update late on a saturated machine.
+ * @return 0 if everything was applied, -1 if anything wasn't */
+int enterLowFootprint();
+
+// Number of C++ heap allocations made so far, by anything in the process
+unsigned long allocationCount();
+
+/* Measures the daemon's steady-state cost over a fixed period, after a few
+ * ticks of warm-up. */
+class SelfCheck {
+private:
+    double m_seconds;
+    long m_ticks;
+    // State at the end of warm-up
+    unsigned long m_startAllocs;
+    struct timespec m_startTime;
+    double m_startCPU;
+
+public:
+    // @param seconds  how long to measure for
+    SelfCheck(double seconds);
+
+    // Call once per tick
+    void tick();
+    // Whether the measurement period is over
+    bool done();
+    /* Print the measurements against the budget.
+     * @return 0 if within budget, -1 if not */
+    int report();
+};
+
+#endif // FOOTPRINT_H_
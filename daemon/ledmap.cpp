@@ -0,0 +1,366 @@
+/******************************************************************************
+ * ledmap.cpp
+ * Copyright 2026 agent
+ *
+ * Configurable mapping from readings to the blinky's LEDs.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <ctype.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "ledmap.h"
+#include "cpustat.h"
+#include "meminfo.h"
+#include "perfstat.h"
+#include "thermal.h"
+
+using namespace std;
+
+LEDInputs::LEDInputs() :
+    m_cpustat(0),
+    m_meminfo(0),
+    m_nodeMem(0),
+    m_events(0),
+    m_eventCPUs(0),
+    m_thermal(0)
+{ }
+
+LEDMap::LEDMap() :
+    m_needs(0),
+    m_tickInterval(1)
+{
+    for(int i=0; i<OUT_COUNT; ++i) {
+        m_outputNeeds[i] = 0;
+    }
+}
+
+/* Read a reduction keyword ("max", or whatever's given) or an index in 
+ * [0,count) from the rule.
+ * @return 1 for the keyword, 0 for an index, -1 on error */
+static int parseIndex(istringstream& rule, const char* what, int count, 
+                      int& index, string& err, const char* keyword = "max")
+{
+    string token;
+    if( !(rule >> token) ) {
+        err = string("expected a ") + what + " number or '" + keyword + "'";
+        return -1;
+    }
+    if(token == keyword) return 1;
+
+    istringstream num(token);
+    if( !(num >> index) || !num.eof() ) {
+        err = string("expected a ") + what + " number or '" + keyword + 
+              "', not '" + token + "'";
+        return -1;
+    }
+    if( (index < 0) || ((count != LEDMap::UNKNOWN_COUNT) && (index >= count)) ) {
+        ostringstream msg;
+        msg << "no " << what << " " << index << " (there are " << count << ")";
+        err = msg.str();
+        return -1;
+    }
+    return 0;
+}
+
+int LEDMap::compileRule(const string& text, int cpuCount, int nodeCount,
+                        int packageCount, string& err)
+{
+    istringstream rule(text);
+    Op op;
+    op.m_index = 0;
+    op.m_curve = CURVE_LINEAR;
+    op.m_offset = 0;
+    op.m_scale = 1;
+
+    /* Output */
+    string token;
+    rule >> token;
+    if(token == "red") {
+        op.m_output = OUT_RED;
+    } else if(token == "yellow") {
+        op.m_output = OUT_YELLOW;
+    } else if( (token.size() == 4) && (token.compare(0, 3, "led") == 0) &&
+               (token[3] >= '0') && (token[3] < '0' + LED_COUNT) ) {
+        op.m_output = token[3] - '0';
+    } else {
+        err = "unknown output '" + token + "'";
+        return -1;
+    }
+
+    /* Source */
+    token.clear();
+    rule >> token;
+    int max;
+    if(token == "cpu") {
+        m_needs |= NEED_CPU;
+        // "cpu" alone is the total; peek for an index
+        string next;
+        streampos pos = rule.tellg();
+        if( (rule >> next) && ((next == "max") || isdigit(next[0])) ) {
+            rule.clear();
+            rule.seekg(pos);
+            max = parseIndex(rule, "cpu", cpuCount, op.m_index, err);
+            if(max < 0) return -1;
+            op.m_source = max ? SRC_CPU_MAX : SRC_CPU;
+        } else {
+            rule.clear();
+            rule.seekg(pos);
+            op.m_source = SRC_CPU_TOTAL;
+        }
+    } else if(token == "node") {
+        m_needs |= NEED_CPU;
+        max = parseIndex(rule, "node", nodeCount, op.m_index, err);
+        if(max < 0) return -1;
+        op.m_source = max ? SRC_NODE_MAX : SRC_NODE;
+    } else if(token == "mem") {
+        string next;
+        streampos pos = rule.tellg();
+        if( (rule >> next) && (next == "node") ) {
+            m_needs |= NEED_NODE_MEM;
+            max = parseIndex(rule, "node", nodeCount, op.m_index, err);
+            if(max < 0) return -1;
+            op.m_source = max ? SRC_MEM_NODE_MAX : SRC_MEM_NODE;
+        } else {
+            rule.clear();
+            rule.seekg(pos);
+            m_needs |= NEED_MEM;
+            op.m_source = SRC_MEM;
+        }
+    } else if( (token == "cswitch") || (token == "migrations") ||
+               (token == "faults") || (token == "majfaults") ) {
+        m_needs |= NEED_EVENTS;
+        if(token == "cswitch") op.m_source = SRC_CSWITCH;
+        else if(token == "migrations") op.m_source = SRC_MIGRATIONS;
+        else if(token == "faults") op.m_source = SRC_FAULTS;
+        else op.m_source = SRC_MAJFAULTS;
+        // Counts per tick -> rate per second.  (Per CPU is done at evaluation.)
+        op.m_scale = 1 / m_tickInterval;
+    } else if(token == "temp") {
+        m_needs |= NEED_THERMAL;
+        max = parseIndex(rule, "package", packageCount, op.m_index, err);
+        if(max < 0) return -1;
+        op.m_source = max ? SRC_TEMP_MAX : SRC_TEMP;
+    } else if(token == "freq") {
+        m_needs |= NEED_THERMAL;
+        max = parseIndex(rule, "package", packageCount, op.m_index, err, "min");
+        if(max < 0) return -1;
+        op.m_source = max ? SRC_FREQ_MIN : SRC_FREQ;
+    } else if(token == "throttle") {
+        m_needs |= NEED_THERMAL;
+        op.m_source = SRC_THROTTLE;
+    } else {
+        err = "unknown source '" + token + "'";
+        return -1;
+    }
+
+    /* Curve.  Event rate scaling is folded into the curve parameters. */
+    double rateScale = op.m_scale;
+    op.m_scale = 1;
+    token.clear();
+    rule >> token;
+    if( token.empty() || (token == "linear") ) {
+        op.m_curve = CURVE_LINEAR;
+        op.m_scale = rateScale;
+    } else if(token == "scale") {
+        double lo, hi;
+        if( !(rule >> lo >> hi) || (hi == lo) ) {
+            err = "scale needs two different numbers";
+            return -1;
+        }
+        op.m_curve = CURVE_SCALE;
+        op.m_offset = lo / rateScale;
+        op.m_scale = rateScale / (hi - lo);
+    } else if(token == "threshold") {
+        double x;
+        if( !(rule >> x) ) {
+            err = "threshold needs a number";
+            return -1;
+        }
+        op.m_curve = CURVE_THRESHOLD;
+        op.m_offset = x / rateScale;
+    } else {
+        err = "unknown curve '" + token + "'";
+        return -1;
+    }
+
+    token.clear();
+    if(rule >> token) {
+        err = "unexpected '" + token + "'";
+        return -1;
+    }
+
+    m_ops.push_back(op);
+    return 0;
+}
+
+int LEDMap::compile(const string& rules, const char* name, int cpuCount,
+                    int nodeCount, int packageCount, double tickInterval)
+{
+    LEDMap compiled;
+    compiled.m_tickInterval = tickInterval;
+
+    istringstream lines(rules);
+    string line;
+    for(int lineNo = 1; getline(lines, line); ++lineNo) {
+        /* Strip comments and skip blank lines */
+        size_t hash = line.find('#');
+        if(hash != string::npos) line.erase(hash);
+        if(line.find_first_not_of(" \t\r") == string::npos) continue;
+
+        string err;
+        unsigned before = compiled.m_needs;
+        compiled.m_needs = 0;
+        if( compiled.compileRule(line, cpuCount, nodeCount, packageCount, err) ) {
+            cerr << name << ":" << lineNo << ": " << err << endl;
+            return -1;
+        }
+        // m_needs now holds just this rule's
+        compiled.m_outputNeeds[compiled.m_ops.back().m_output] |= compiled.m_needs;
+        compiled.m_needs |= before;
+    }
+
+    *this = compiled;
+    return 0;
+}
+
+int LEDMap::load(const char* path, int cpuCount, int nodeCount, 
+                 int packageCount, double tickInterval)
+{
+    ifstream file(path);
+    if(file.fail()) {
+        cerr << "Failed to open " << path << endl;
+        return -1;
+    }
+    ostringstream rules;
+    rules << file.rdbuf();
+    return compile(rules.str(), path, cpuCount, nodeCount, packageCount,
+                   tickInterval);
+}
+
+double LEDMap::read(const Op& op, LEDInputs& in)
+{
+    CPUStat* cpu = in.m_cpustat;
+    ThermalStat* thermal = in.m_thermal;
+    double val = 0;
+
+    switch(op.m_source) {
+    case SRC_CPU_TOTAL:
+        return cpu ? cpu->totalDiff().getUtilization() : 0;
+    case SRC_CPU:
+        if( !cpu || (op.m_index >= cpu->cpuCount()) ) return 0;
+        return cpu->cpuDiff(op.m_index).getUtilization();
+    case SRC_CPU_MAX:
+        for(int i=0; cpu && (i<cpu->cpuCount()); ++i) {
+            val = max(val, cpu->cpuDiff(i).getUtilization());
+        }
+        return val;
+    case SRC_NODE:
+        if( !cpu || (op.m_index >= cpu->nodeCount()) ) return 0;
+        return cpu->nodeDiff(op.m_index).getUtilization();
+    case SRC_NODE_MAX:
+        for(int i=0; cpu && (i<cpu->nodeCount()); ++i) {
+            val = max(val, cpu->nodeDiff(i).getUtilization());
+        }
+        return val;
+    case SRC_MEM:
+        return in.m_meminfo ? in.m_meminfo->getUtilization() : 0;
+    case SRC_MEM_NODE:
+        if( !in.m_nodeMem || ((size_t)op.m_index >= in.m_nodeMem->size()) ) {
+            return 0;
+        }
+        return (*in.m_nodeMem)[op.m_index]->getUtilization();
+    case SRC_MEM_NODE_MAX:
+        for(size_t i=0; in.m_nodeMem && (i<in.m_nodeMem->size()); ++i) {
+            val = max(val, (*in.m_nodeMem)[i]->getUtilization());
+        }
+        return val;
+    case SRC_CSWITCH:
+    case SRC_MIGRATIONS:
+    case SRC_FAULTS:
+    case SRC_MAJFAULTS:
+        if( !in.m_events || (in.m_eventCPUs <= 0) ) return 0;
+        if(op.m_source == SRC_CSWITCH) val = in.m_events->m_contextSwitches;
+        else if(op.m_source == SRC_MIGRATIONS) val = in.m_events->m_migrations;
+        else if(op.m_source == SRC_FAULTS) val = in.m_events->m_faults;
+        else val = in.m_events->m_majorFaults;
+        return val / in.m_eventCPUs;
+    case SRC_TEMP:
+        if( !thermal || (op.m_index >= thermal->packageCount()) ) return 0;
+        return thermal->temp(op.m_index);
+    case SRC_TEMP_MAX:
+        for(int i=0; thermal && (i<thermal->packageCount()); ++i) {
+            val = max(val, thermal->temp(i));
+        }
+        return val;
+    case SRC_FREQ:
+        if( !thermal || (op.m_index >= thermal->packageCount()) ) return 0;
+        return thermal->freqRatio(op.m_index);
+    case SRC_FREQ_MIN:
+        if( !thermal || !thermal->packageCount() ) return 0;
+        val = thermal->freqRatio(0);
+        for(int i=1; i<thermal->packageCount(); ++i) {
+            val = min(val, thermal->freqRatio(i));
+        }
+        return val;
+    case SRC_THROTTLE:
+        for(int i=0; thermal && (i<thermal->packageCount()); ++i) {
+            if(thermal->throttled(i)) return 1;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+void LEDMap::evaluate(LEDInputs& in, BlinkyState& out)
+{
+    double outputs[OUT_COUNT] = { 0 };
+
+    for(size_t i=0; i<m_ops.size(); ++i) {
+        const Op& op = m_ops[i];
+        double val = read(op, in);
+        // (NaN, e.g. from a zero-length tick, reads as 0)
+        if( !(val > 0) ) val = 0;
+
+        switch(op.m_curve) {
+        case CURVE_LINEAR:
+            val *= op.m_scale;
+            break;
+        case CURVE_SCALE:
+            val = (val - op.m_offset) * op.m_scale;
+            if(val < 0) val = 0;
+            if(val > 1) val = 1;
+            break;
+        case CURVE_THRESHOLD:
+            val = (val >= op.m_offset) ? 1 : 0;
+            break;
+        }
+
+        outputs[op.m_output] = max(outputs[op.m_output], val);
+    }
+
+    /* Linear sources like temp or cswitch go well past 1, and the blinky
+     * only takes [0,1] */
+    for(int i=0; i<LED_COUNT; ++i) {
+        out.m_leds[i] = min(outputs[i], 1.0);
+    }
+    out.m_red = outputs[OUT_RED] >= 0.5;
+    out.m_yellow = outputs[OUT_YELLOW] >= 0.5;
+}
@@ -0,0 +1,183 @@
+/******************************************************************************
+ * ledmap.h
+ * Copyright 2026 agent
+ *
+ * Configurable mapping from readings to the blinky's LEDs.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef LEDMAP_H_
+#define LEDMAP_H_
+
+#include <string>
+#include <vector>
+
+#include "blinky.h"
+
+class CPUStat;
+class Meminfo;
+class PerfCounts;
+class ThermalStat;
+
+/* The readings a LEDMap is evaluated against.  Pointers are NULL for 
+ * readings which aren't available. */
+struct LEDInputs {
+    CPUStat* m_cpustat;
+    Meminfo* m_meminfo;
+    // Memory utilization of each NUMA node
+    std::vector<Meminfo*>* m_nodeMem;
+    // Event deltas over the last tick, and how many CPUs they were counted on
+    PerfCounts* m_events;
+    int m_eventCPUs;
+    ThermalStat* m_thermal;
+
+    LEDInputs();
+};
+
+/* A set of rules mapping readings onto the blinky's outputs.
+ *
+ * Rules are written one per line, as
+ *     <output> <source> [<curve>]
+ * where <output> is led0 - led5, red or yellow, and <source> is one of
+ *     cpu               total CPU utilization
+ *     cpu <n>           utilization of the n'th CPU
+ *     cpu max           utilization of the busiest CPU
+ *     node <n>          CPU utilization of the n'th NUMA node
+ *     node max          CPU utilization of the busiest node
+ *     mem               system memory utilization
+ *     mem node <n>      memory utilization of the n'th node
+ *     mem node max      memory utilization of the fullest node
+ *                       (nodes are only sampled with two or more of them)
+ *     cswitch, migrations, faults, majfaults
+ *                       event rates, per CPU per second
+ *     temp <n>          temperature of the n'th CPU package, in degrees C
+ *     temp max          temperature of the hottest package
+ *     freq <n>          clock of the n'th package, as a fraction of its max
+ *     freq min          clock of the slowest package
+ *     throttle          1 if any package is hot and running slow, else 0
+ * and <curve> is one of
+ *     linear            the reading as is (the default)
+ *     scale <lo> <hi>   lo..hi mapped onto 0..1, clamped
+ *     threshold <x>     1 if the reading is at least x, else 0
+ * Utilizations are fractions in [0,1].  If several rules drive the same 
+ * output, the largest value wins, and LEDs are clamped to [0,1], so a raw
+ * reading like temp lights its LED fully.  red and yellow light at 0.5 or 
+ * more.
+ * Anything after a '#' is a comment.
+ *
+ * Rules are compiled into a flat list of operations with every index and 
+ * scale factor resolved up front, so evaluating them is a single pass with
+ * no lookups.  needs() reports which readings the rules use, so the rest
+ * needn't be sampled at all. */
+class LEDMap {
+public:
+    // Readings, for needs()
+    enum Need {
+        NEED_CPU = 0x1,
+        NEED_MEM = 0x2,
+        NEED_NODE_MEM = 0x4,
+        NEED_EVENTS = 0x8,
+        NEED_THERMAL = 0x10,
+        NEED_ALL = 0x1f,
+    };
+    // For compile(), when the number of CPUs, nodes or packages isn't known
+    static const int UNKNOWN_COUNT = -1;
+    // Outputs are indexed by LED number, then these
+    enum {
+        OUT_RED = LED_COUNT,
+        OUT_YELLOW,
+        OUT_COUNT,
+    };
+
+private:
+    enum OpSource {
+        SRC_CPU_TOTAL,
+        SRC_CPU,
+        SRC_CPU_MAX,
+        SRC_NODE,
+        SRC_NODE_MAX,
+        SRC_MEM,
+        SRC_MEM_NODE,
+        SRC_MEM_NODE_MAX,
+        SRC_CSWITCH,
+        SRC_MIGRATIONS,
+        SRC_FAULTS,
+        SRC_MAJFAULTS,
+        SRC_TEMP,
+        SRC_TEMP_MAX,
+        SRC_FREQ,
+        SRC_FREQ_MIN,
+        SRC_THROTTLE,
+    };
+    enum OpCurve {
+        CURVE_LINEAR,
+        CURVE_SCALE,
+        CURVE_THRESHOLD,
+    };
+    struct Op {
+        OpSource m_source;
+        // CPU or node index, for sources that need one
+        int m_index;
+        OpCurve m_curve;
+        // For scale: offset and 1/range.  For threshold: the threshold.
+        double m_offset;
+        double m_scale;
+        int m_output;
+    };
+    std::vector<Op> m_ops;
+    unsigned m_needs;
+    // Which readings drive each output
+    unsigned m_outputNeeds[OUT_COUNT];
+    // Seconds between updates, for event rates
+    double m_tickInterval;
+
+    /* Compile one rule onto the end of m_ops.
+     * @return 0 on success, or -1 on error, with the reason in err */
+    int compileRule(const std::string& rule, int cpuCount, int nodeCount,
+                    int packageCount, std::string& err);
+    double read(const Op& op, LEDInputs& in);
+
+public:
+    LEDMap();
+
+    /* Compile a set of rules, replacing any current ones.  On failure, the
+     * problem is reported on stderr and the map is left unchanged.
+     * @param name      where the rules came from, for error messages
+     * @param cpuCount  number of CPUs, to check rules against
+     * @param nodeCount number of NUMA nodes, to check rules against
+     * @param packageCount  number of CPU packages, to check rules against
+     * Any count may be UNKNOWN_COUNT, so that any index compiles.  Indices 
+     * with nothing behind them read as 0.
+     * @return 0 on success, -1 on failure */
+    int compile(const std::string& rules, const char* name, int cpuCount,
+                int nodeCount, int packageCount, double tickInterval);
+    // As compile(), with rules read from a file
+    int load(const char* path, int cpuCount, int nodeCount, int packageCount,
+             double tickInterval);
+
+    // Which readings the rules use, as a mask of Need
+    unsigned needs()
+        { return m_needs; }
+    // Which readings drive one output (an LED number, or OUT_RED/OUT_YELLOW)
+    unsigned outputNeeds(int output)
+        { return m_outputNeeds[output]; }
+
+    // Work out what the blinky should show
+    void evaluate(LEDInputs& in, BlinkyState& out);
+};
+
+#endif // LEDMAP_H_
@@ -22,19 +22,46 @@
 
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "main.h"
+#include "collector.h"
 #include "cpustat.h"
 #include "meminfo.h"
+#include "numa.h"
+#include "perfstat.h"
+#include "thermal.h"
+#include "metricsserver.h"
+#include "flightlog.h"
+#include "ledmap.h"
+#include "footprint.h"
 #include "blinky.h"
 
 using namespace std;
 
+/* Event rates, per CPU per second, above which the box is considered to be
+ * thrashing and the red LED is lit. */
+#define THRASH_CSWITCH_RATE 20000
+#define THRASH_MIGRATION_RATE 1000
+#define THRASH_MAJFAULT_RATE 100
+
+// Seconds between samples
+#define TICK_INTERVAL 0.5
+
+// Readings the flight log doesn't keep
+#define UNLOGGED_NEEDS (LEDMap::NEED_NODE_MEM | LEDMap::NEED_THERMAL)
+
 // Fork a child, close inherited files, blah blah blah
 int daemonize() {
     int ret = fork();
@@ -64,35 +91,510 @@ int daemonize() {
     return 0;
 }
 
+// Set by SIGTERM / SIGINT
+static volatile sig_atomic_t g_stop = 0;
+// Set by SIGHUP
+static volatile sig_atomic_t g_reload = 0;
+// Whether anyone will see the status line
+static bool g_showStatus = true;
+
+void handleStop(int)
+{
+    g_stop = 1;
+}
+
+void handleReload(int)
+{
+    g_reload = 1;
+}
+
+/* Advance the deadline by one tick and sleep until it, or until we're told
+ * to stop.  If there's a metrics server, its clients are served while we 
+ * wait.
+ * @param fds  room for server->pollfdCount() pollfds */
+void waitForTick(struct timespec& deadline, MetricsServer* server, 
+                 struct pollfd* fds)
+{
+    long long next = deadline.tv_nsec + (long long)(TICK_INTERVAL * 1000000000LL);
+    deadline.tv_sec += next / 1000000000LL;
+    deadline.tv_nsec = next % 1000000000LL;
+
+    while(!g_stop) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long nsLeft = (deadline.tv_sec - now.tv_sec) * 1000000000LL +
+                           (deadline.tv_nsec - now.tv_nsec);
+        if(nsLeft <= 0) {
+            if(nsLeft < -TICK_INTERVAL * 1000000000LL) {
+                // We've fallen well behind.  Don't try to catch up.
+                deadline = now;
+            }
+            break;
+        }
+
+        // Round up, so we don't spin for the last partial millisecond
+        int msLeft = (nsLeft + 999999) / 1000000;
+        int count = server ? server->fillPollfds(fds) : 0;
+        if(poll(fds, count, msLeft) > 0) {
+            server->handlePollfds(fds, count);
+        }
+    }
+}
+
+/* The LED rules used when there's no config file */
+string defaultLEDMap(int cpuCount, int nodeCount)
+{
+    ostringstream rules;
+
+    /* If 2 cores, we use both green LEDs for load.  With several NUMA nodes,
+     * one node can be saturated while the total looks fine, so the second
+     * LED shows the busiest node.  Otherwise, we use both and set them to
+     * total system utilization */
+    if(nodeCount > 1) {
+        rules << "led5 cpu\nled4 node max\n";
+    } else if(cpuCount == 2) {
+        rules << "led5 cpu 0\nled4 cpu 1\n";
+    } else {
+        rules << "led5 cpu\nled4 cpu\n";
+    }
+
+    /* Likewise, a node can run out of memory while the system hasn't */
+    rules << "led3 mem\n";
+    if(nodeCount > 1) {
+        rules << "led2 mem node max\n";
+    }
+
+    /* Light the red LED when the box is thrashing, even if utilization
+     * looks healthy */
+    rules << "red cswitch threshold " << THRASH_CSWITCH_RATE << "\n";
+    rules << "red migrations threshold " << THRASH_MIGRATION_RATE << "\n";
+    rules << "red majfaults threshold " << THRASH_MAJFAULT_RATE << "\n";
+
+    /* Load doesn't show a package running at half clock because it's too
+     * hot, so light yellow for that */
+    rules << "yellow throttle\n";
+    return rules.str();
+}
+
+/* Compile LED rules from a config file, or the defaults if there isn't one.
+ * @return 0 on success, -1 on failure */
+int loadLEDMap(LEDMap& map, const char* configPath, int cpuCount, 
+               int nodeCount, int packageCount)
+{
+    if(configPath) {
+        return map.load(configPath, cpuCount, nodeCount, packageCount,
+                        TICK_INTERVAL);
+    }
+    return map.compile(defaultLEDMap(cpuCount, nodeCount), "defaults", 
+                       cpuCount, nodeCount, packageCount, TICK_INTERVAL);
+}
+
+// Print a one-line summary of the latest readings over the previous one
+void printStatus(CPUStat& cpustat, Meminfo& meminfo, PerfCounts* events)
+{
+    if(!g_showStatus) return;
+
+    cout << "\rTotal: " << setw(5) << cpustat.totalDiff().getUtilization() * 100 << "%";
+    for(int i=0; i<cpustat.cpuCount(); ++i) {
+        cout << " CPU " << i << ": ";
+        cout << setw(5) << cpustat.cpuDiff(i).getUtilization() * 100 << "%";
+    }
+    cout << " Mem: " << meminfo.getUtilization() * 100 << "%";
+    for(int i=0; i<cpustat.nodeCount(); ++i) {
+        cout << " Node " << i << ": ";
+        cout << setw(5) << cpustat.nodeDiff(i).getUtilization() * 100 << "%";
+    }
+    if(events) {
+        cout << " Csw/s: " << setw(7) << events->m_contextSwitches / TICK_INTERVAL;
+    }
+    cout << flush;
+}
+
+// Check if a file descriptor is /dev/null
+bool isDevNull(int fd)
+{
+    struct stat fdStat, nullStat;
+    if( fstat(fd, &fdStat) || stat("/dev/null", &nullStat) ) return false;
+    return S_ISCHR(fdStat.st_mode) && (fdStat.st_rdev == nullStat.st_rdev);
+}
+
+// Milliseconds on the monotonic clock
+long long monotonicMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+/* Sample the system and drive the blinky until stopped.
+ * @param selfcheck  if not NULL, stop when its measurement is done and 
+ *                   report it
+ * @return the process exit status */
+int run(Blinky& blinky, const char* configPath, const char* metricsSocket,
+        const char* recordPath, size_t recordBytes, SelfCheck* selfcheck)
+{
+    /* Everything we sample from /proc is read together, once per tick */
+    Collector collector;
+    CPUStat cpustat;
+    if(collector.add(&cpustat)) {
+        cerr <<  "Failed to open cpu utilization." << endl;
+    }
+    Meminfo meminfo;
+    if(collector.add(&meminfo)) {
+        cerr << "Failed to open memory utilization." << endl;
+    }
+
+    /* Per-NUMA-node figures, on hosts with more than one node */
+    NumaTopology topology;
+    if(topology.discover()) {
+        cerr << "Failed to read NUMA topology." << endl;
+    }
+    std::vector<Meminfo*> nodeMem;
+    if(topology.nodeCount() > 1) {
+        cpustat.setTopology(topology.cpuNodes(), topology.nodeCount());
+        for(int i=0; i<topology.nodeCount(); ++i) {
+            nodeMem.push_back(new Meminfo(topology.nodeId(i)));
+            if(collector.add(nodeMem.back())) {
+                cerr << "Failed to open node " << topology.nodeId(i)
+                     << " memory utilization." << endl;
+            }
+        }
+    }
+
+    /* Package temperatures and clocks, where the hardware exposes them */
+    ThermalStat thermal;
+    thermal.discover();
+    thermal.addTo(collector);
+
+    if(collector.collect()) {
+        cerr << "Failed to obtain cpu and memory utilization." << endl;
+    }
+
+    /* Scheduler / VM event counters are optional */
+    PerfStat perfstat;
+
+    /* Only check node rules against the nodes which are actually sampled,
+     * so they fail to compile rather than read 0 forever on one node */
+    LEDMap ledmap;
+    if(loadLEDMap(ledmap, configPath, cpustat.cpuCount(), cpustat.nodeCount(),
+                  thermal.packageCount())) {
+        return 1;
+    }
+
+    MetricsServer* metrics = 0;
+    if(metricsSocket) {
+        metrics = new MetricsServer(metricsSocket);
+        if(metrics->open()) {
+            cerr << "Failed to open metrics socket." << endl;
+            delete metrics;
+            metrics = 0;
+        }
+    }
+    std::vector<struct pollfd> pollfds(metrics ? metrics->pollfdCount() : 1);
+
+    FlightRecorder* recorder = 0;
+    if(recordPath) {
+        recorder = new FlightRecorder(recordPath, recordBytes);
+        if(recorder->open()) {
+            cerr << "Failed to open flight log." << endl;
+            delete recorder;
+            recorder = 0;
+        }
+    }
+    FlightSample sample;
+
+    LEDInputs inputs;
+    inputs.m_cpustat = &cpustat;
+    inputs.m_meminfo = &meminfo;
+    inputs.m_nodeMem = &nodeMem;
+    inputs.m_thermal = &thermal;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    cout << setprecision(3);
+    bool needsChanged = true;
+    unsigned needs = 0;
+    while(!g_stop) {
+        waitForTick(deadline, metrics, &pollfds[0]);
+        if(g_stop) break;
+
+        /* Swap in new rules between ticks.  If they don't compile, the old
+         * ones stay. */
+        if(g_reload) {
+            g_reload = 0;
+            LEDMap reloaded;
+            if(loadLEDMap(reloaded, configPath, cpustat.cpuCount(), 
+                          cpustat.nodeCount(), thermal.packageCount()) == 0) {
+                ledmap = reloaded;
+                needsChanged = true;
+            }
+        }
+
+        /* Only sample what the rules use.  The metrics server and flight
+         * recorder report everything. */
+        if(needsChanged) {
+            needsChanged = false;
+            needs = ledmap.needs();
+            if(metrics || recorder) needs |= LEDMap::NEED_ALL;
+            collector.setEnabled(&cpustat, needs & LEDMap::NEED_CPU);
+            collector.setEnabled(&meminfo, needs & LEDMap::NEED_MEM);
+            for(size_t i=0; i<nodeMem.size(); ++i) {
+                collector.setEnabled(nodeMem[i], needs & LEDMap::NEED_NODE_MEM);
+            }
+            thermal.setEnabled(collector, needs & LEDMap::NEED_THERMAL);
+            if( (needs & LEDMap::NEED_EVENTS) && !perfstat.available() ) {
+                perfstat.open();
+            } else if( !(needs & LEDMap::NEED_EVENTS) ) {
+                perfstat.close();
+            }
+        }
+
+        collector.collect();
+        if(needs & LEDMap::NEED_THERMAL) {
+            thermal.update();
+        }
+        PerfCounts* events = 0;
+        if(perfstat.update() == 0) {
+            events = &perfstat.totalDiff();
+        }
+
+        inputs.m_events = events;
+        inputs.m_eventCPUs = perfstat.openCount();
+        ledmap.evaluate(inputs, sample.m_outputs);
+        blinky.show(sample.m_outputs);
+        printStatus(cpustat, meminfo, events);
+
+        if(metrics) {
+            metrics->render(cpustat, meminfo, perfstat, blinky.isOpen());
+        }
+
+        if(recorder) {
+            sample.m_time = monotonicMs();
+            sample.m_total = cpustat.total();
+            sample.m_cpus.resize(cpustat.cpuCount());
+            for(int i=0; i<cpustat.cpuCount(); ++i) {
+                sample.m_cpus[i] = cpustat.cpu(i);
+            }
+            sample.m_memTotal = meminfo.m_total;
+            sample.m_memFree = meminfo.m_free;
+            sample.m_memBuffers = meminfo.m_buffers;
+            sample.m_memCached = meminfo.m_cached;
+            sample.m_hasEvents = events;
+            if(events) sample.m_events = *events;
+            sample.m_nodeCount = cpustat.nodeCount();
+            sample.m_packageCount = thermal.packageCount();
+            sample.m_cpuNodes.resize(cpustat.cpuCount());
+            for(int i=0; i<cpustat.cpuCount(); ++i) {
+                sample.m_cpuNodes[i] = cpustat.cpuNode(i);
+            }
+            recorder->record(sample);
+        }
+
+        if(selfcheck) {
+            selfcheck->tick();
+            if(selfcheck->done()) break;
+        }
+    }
+
+    if(g_showStatus) cout << endl;
+    delete recorder;
+    delete metrics;
+    for(size_t i=0; i<nodeMem.size(); ++i) {
+        delete nodeMem[i];
+    }
+    if(selfcheck) {
+        return selfcheck->report() ? 1 : 0;
+    }
+    return 0;
+}
+
+/* Feed a flight log back through the normal mapping and blinky output.
+ * @param speed  playback speed relative to real time.  0 plays back as fast
+ *               as possible, for benchmarking.
+ * @param blinky where to show the replayed outputs, or NULL for nowhere
+ * @return the process exit status */
+int replay(const char* path, const char* configPath, double speed, 
+           Blinky* blinky)
+{
+    FlightReplayer replayer(path);
+    if(replayer.open()) {
+        return 1;
+    }
+
+    CPUStat cpustat;
+    Meminfo meminfo;
+    FlightSample sample;
+    LEDMap ledmap;
+    LEDInputs inputs;
+    inputs.m_cpustat = &cpustat;
+    inputs.m_meminfo = &meminfo;
+    BlinkyState outputs;
+    long ticks = 0;
+    // Ticks where the replayed outputs differ from what was recorded
+    long mismatches = 0;
+    // Outputs driven only by logged readings, which replay can reproduce
+    bool compared[LEDMap::OUT_COUNT];
+    long long prevTime = -1;
+    long long start = monotonicMs();
+    int status = 0;
+
+    cout << setprecision(3);
+    while( !g_stop && ((status = replayer.next(sample)) > 0) ) {
+        if( (speed > 0) && (prevTime >= 0) && (sample.m_time > prevTime) ) {
+            usleep((sample.m_time - prevTime) * 1000 / speed);
+        }
+        prevTime = sample.m_time;
+
+        /* The rules can't be compiled until the first keyframe says what
+         * the host looked like.  Node CPU figures can be rebuilt from the
+         * logged topology, but node memory and thermal readings aren't
+         * logged; those read as 0, and their outputs aren't compared. */
+        if(ticks == 0) {
+            if( loadLEDMap(ledmap, configPath, sample.m_cpus.size(), 
+                           sample.m_nodeCount, sample.m_packageCount) ) {
+                return 1;
+            }
+            if(sample.m_nodeCount > 0) {
+                cpustat.setTopology(sample.m_cpuNodes, sample.m_nodeCount);
+            }
+            for(int i=0; i<LEDMap::OUT_COUNT; ++i) {
+                compared[i] = !(ledmap.outputNeeds(i) & UNLOGGED_NEEDS);
+            }
+        }
+
+        cpustat.load(sample.m_total, sample.m_cpus);
+        meminfo.m_total = sample.m_memTotal;
+        meminfo.m_free = sample.m_memFree;
+        meminfo.m_buffers = sample.m_memBuffers;
+        meminfo.m_cached = sample.m_memCached;
+        PerfCounts* events = sample.m_hasEvents ? &sample.m_events : 0;
+
+        // The log doesn't say how many CPUs were counted; assume all of them
+        inputs.m_events = events;
+        inputs.m_eventCPUs = sample.m_cpus.size();
+        ledmap.evaluate(inputs, outputs);
+        if(blinky) blinky->show(outputs);
+        if(speed > 0) printStatus(cpustat, meminfo, events);
+
+        /* The log only has 8 bits per LED.  The first tick is also skipped,
+         * since the recorder didn't start at boot like we do. */
+        bool differs = false;
+        for(int i=0; (ticks > 0) && (i<LED_COUNT); ++i) {
+            double led = outputs.m_leds[i];
+            if( !(led > 0) ) led = 0;
+            if(led > 1) led = 1;
+            if( compared[i] && 
+                (fabs(led - sample.m_outputs.m_leds[i]) > 1 / 255.0) ) {
+                differs = true;
+            }
+        }
+        if( (ticks > 0) && compared[LEDMap::OUT_RED] && 
+            (outputs.m_red != sample.m_outputs.m_red) ) {
+            differs = true;
+        }
+        if( (ticks > 0) && compared[LEDMap::OUT_YELLOW] && 
+            (outputs.m_yellow != sample.m_outputs.m_yellow) ) {
+            differs = true;
+        }
+        if(differs) ++mismatches;
+        ++ticks;
+    }
+
+    double elapsed = (monotonicMs() - start) / 1000.0;
+    cout << endl << "Replayed " << ticks << " ticks in " << elapsed << "s";
+    if(elapsed > 0) cout << " (" << ticks / elapsed << " ticks/s)";
+    cout << ", " << mismatches << " differed from the recorded outputs." << endl;
+
+    string skipped;
+    for(int i=0; (ticks > 0) && (i<LEDMap::OUT_COUNT); ++i) {
+        if(compared[i]) continue;
+        if(i == LEDMap::OUT_RED) skipped += " red";
+        else if(i == LEDMap::OUT_YELLOW) skipped += " yellow";
+        else skipped += " led" + string(1, '0' + i);
+    }
+    if( !skipped.empty() ) {
+        cout << "Not compared, as they use node memory or thermal readings "
+             << "which aren't logged:" << skipped << endl;
+    }
+    return status < 0 ? 1 : 0;
+}
+
 // Print usage message
 void usage(const char *bin) {
     cout << "Usage:" << endl;
-    cout << bin << " [-f] -p port" << endl;
+    cout << bin << " [-f] [-c config] [-s socket] [-w log [-m MB]] -p port" << endl;
+    cout << bin << " [-f] [-c config] [-x speed] [-p port] -r log" << endl;
+    cout << bin << " -S seconds [options] -p port" << endl;
     cout << "-f  Run in foreground" << endl;
+    cout << "-l  Low footprint: idle priority, lazy timers, locked memory" << endl;
+    cout << "-S  Run in the foreground for a while, then report resource usage" << endl;
+    cout << "-c  Read LED rules from a file (reread on SIGHUP)" << endl;
     cout << "-p  Specify serial port to use to commmunicate with blinky" << endl;
+    cout << "-s  Serve metrics on a unix socket at the given path" << endl;
+    cout << "-w  Record readings to a flight log at the given path" << endl;
+    cout << "-m  Cap the flight log (and its .1 backup) at this many MB (default 64)" << endl;
+    cout << "-r  Replay a flight log instead of sampling this machine (implies -f)" << endl;
+    cout << "-x  Replay speed relative to real time; 0 for as fast as possible" << endl;
 }
 
 int main(int argc, char *argv[])
 {
     /* Parse args */
     bool shouldDaemonize = true;
+    bool lowFootprint = false;
+    double checkSeconds = 0;
     char* blinkyPort = 0;
+    char* configPath = 0;
+    char* metricsSocket = 0;
+    char* recordPath = 0;
+    long recordMB = 64;
+    char* replayPath = 0;
+    double replaySpeed = 1;
     for (int i=1; i < argc; ++i) {
         if (strcmp("-f", argv[i]) == 0) {
             shouldDaemonize = false;
-        } else if (strcmp("-p", argv[i]) == 0) {
-            if (i+1 >= argc) {
+            continue;
+        }
+        if (strcmp("-l", argv[i]) == 0) {
+            lowFootprint = true;
+            continue;
+        }
+        // All other options take an argument
+        if (i+1 >= argc) {
+            usage(argv[0]);
+            exit(1);
+        }
+        if (strcmp("-p", argv[i]) == 0) {
+            blinkyPort = argv[++i];
+        } else if (strcmp("-S", argv[i]) == 0) {
+            checkSeconds = atof(argv[++i]);
+            if (checkSeconds <= 0) {
                 usage(argv[0]);
                 exit(1);
             }
-            blinkyPort = argv[++i];
+            shouldDaemonize = false;
+        } else if (strcmp("-c", argv[i]) == 0) {
+            configPath = argv[++i];
+        } else if (strcmp("-s", argv[i]) == 0) {
+            metricsSocket = argv[++i];
+        } else if (strcmp("-w", argv[i]) == 0) {
+            recordPath = argv[++i];
+        } else if (strcmp("-m", argv[i]) == 0) {
+            recordMB = atol(argv[++i]);
+        } else if (strcmp("-r", argv[i]) == 0) {
+            replayPath = argv[++i];
+            // Replay reports to the terminal, so it always runs in front
+            shouldDaemonize = false;
+        } else if (strcmp("-x", argv[i]) == 0) {
+            replaySpeed = atof(argv[++i]);
         } else {
             usage(argv[0]);
             exit(1);
         }
     }
 
-    if (!blinkyPort) {
+    // A blinky is optional when replaying, e.g. for benchmarking
+    if ( (!blinkyPort && !replayPath) || (recordMB <= 0) || (replaySpeed < 0) ) {
         usage(argv[0]);
         exit(1);
     }
@@ -102,63 +604,65 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    CPUStat cpustat;
-    if(cpustat.update()) {
-        cerr <<  "Failed to obtain cpu utilization." << endl;
-    }
+    // Socket clients hanging up early shouldn't kill us
+    signal(SIGPIPE, SIG_IGN);
+    // Stop cleanly, so buffered flight log records aren't lost
+    signal(SIGTERM, handleStop);
+    signal(SIGINT, handleStop);
+    signal(SIGHUP, handleReload);
 
-    Meminfo meminfo;
-    if(meminfo.update()) {
-        cerr << "Failed to obtain memory utilization." << endl;
-    }
+    /* Don't bother formatting a status line for nobody.  The self-check
+     * measures the daemon as it runs in the background, so skip it there
+     * too. */
+    g_showStatus = !isDevNull(STDOUT_FILENO) && (checkSeconds == 0);
 
-    Blinky blinky(blinkyPort);
-    if( ! blinky.ready() ) {
-        cerr << "Failed to open blinky device." << endl;
+    if(lowFootprint) {
+        enterLowFootprint();
     }
-    if( ! blinky.isBlinky() ) {
-        cerr << "Blinky is not a blinky." << endl;
-    } else {
-        cout << "Successfully opened communications with blinky!" << endl;
-    }
-    blinky.setLEDs(0);
-
-    cout << setprecision(3);
-    while(1) {
-        usleep(500 * 1000);
 
-        cpustat.update();
-        cout << "\rTotal: " << setw(5) << cpustat.totalDiff().getUtilization() * 100 << "%";
-        for(int i=0; i<cpustat.cpuCount(); ++i) {
-            cout << " CPU " << i << ": ";
-            cout << setw(5) << cpustat.cpuDiff(i).getUtilization() * 100 << "%";
+    Blinky* blinky = 0;
+    if(blinkyPort) {
+        blinky = new Blinky(blinkyPort);
+        if( ! blinky->ready() ) {
+            cerr << "Failed to open blinky device." << endl;
         }
-
-        /* If 2 cores, we use both green LEDs for load.  Otherwise, we use both
-         * and set them to total system utilization */
-        if(cpustat.cpuCount() == 2) {
-            blinky.setLED(5, cpustat.cpuDiff(0).getUtilization());
-            blinky.setLED(4, cpustat.cpuDiff(1).getUtilization());
+        if( ! blinky->isBlinky() ) {
+            cerr << "Blinky is not a blinky." << endl;
         } else {
-            blinky.setLED(5, cpustat.totalDiff().getUtilization());
-            blinky.setLED(4, cpustat.totalDiff().getUtilization());
+            cout << "Successfully opened communications with blinky!" << endl;
         }
+        blinky->setLEDs(0);
+    }
 
-        meminfo.update();
-        cout << " Mem: " << meminfo.getUtilization() * 100 << "%";
-        blinky.setLED(3, meminfo.getUtilization());
-
-        cout << flush;
+    int ret;
+    if(replayPath) {
+        ret = replay(replayPath, configPath, replaySpeed, blinky);
+    } else {
+        SelfCheck* selfcheck = 0;
+        if(checkSeconds > 0) {
+            selfcheck = new SelfCheck(checkSeconds);
+        }
+        ret = run(*blinky, configPath, metricsSocket, recordPath, 
+                  recordMB * 1024 * 1024, selfcheck);
+        delete selfcheck;
     }
-    return 0;
+    delete blinky;
+    return ret;
 }
 
-void clearLine(std::istream& stream)
+const char* nextLine(const char* buf)
 {
-    char ch;
-    do {
-        stream.get(ch);
-    } while( (!stream.eof()) && (ch != '\n') );
+    while( (*buf != '\n') && (*buf != '\0') ) ++buf;
+    if( *buf == '\n' ) ++buf;
+    return buf;
 }
 
-
+int parseLong(const char*& p, long& out)
+{
+    char* end;
+    long val = strtol(p, &end, 10);
+    if( end == p ) return -1;
+    out = val;
+    p = end;
+    return 0;
+}
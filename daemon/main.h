@@ -23,10 +23,11 @@
 #ifndef MAIN_H_
 #define MAIN_H_
 
-#include <iostream>
-
-// Read from a stream until a newline is consumed
-void clearLine(std::istream& stream);
+// Advance to the start of the next line (or the terminating NUL)
+const char* nextLine(const char* buf);
+/* Parse a decimal integer, skipping leading spaces, and advance p past it.
+ * @return 0 on success, -1 if there was no number at p */
+int parseLong(const char*& p, long& out);
 
 #endif // MAIN_H_
 
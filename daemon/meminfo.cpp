@@ -21,43 +21,62 @@
  *****************************************************************************/
 
 #include <iostream>
-#include <fstream>
-#include <string>
+#include <stdio.h>
+#include <string.h>
 
 #include "meminfo.h"
 #include "main.h"
 
 using namespace std;
 
-int Meminfo::update()
+Meminfo::Meminfo(int node) :
+    m_total(0),
+    m_free(0),
+    m_buffers(0),
+    m_cached(0)
 {
-    fstream procMeminfo ("/proc/meminfo", ios_base::in);
-    if( procMeminfo.fail() ) {
-        cout << "Failed to open /proc/meminfo" << endl;
-        return -1;
+    if(node < 0) {
+        strcpy(m_path, "/proc/meminfo");
+    } else {
+        snprintf(m_path, sizeof(m_path), 
+                 "/sys/devices/system/node/node%d/meminfo", node);
     }
+}
 
-    /* Run through /proc/meminfo, seeking the info we actually care about */
-    string key;
-    while( ! procMeminfo.eof() ) {
-        procMeminfo >> key; 
-        // Usually caused by empty line at eof:
-        if(procMeminfo.fail()) break;
+/* If line starts with key, parse the value following it into out.
+ * @return true if the key matched */
+static bool parseField(const char* line, const char* key, long& out)
+{
+    size_t keyLen = strlen(key);
+    if( strncmp(line, key, keyLen) ) return false;
+    const char* p = line + keyLen;
+    parseLong(p, out);
+    return true;
+}
 
-        /* Is this a key we're looking for? */
-        if( key == "MemTotal:" ) {
-            procMeminfo >> m_total;
-        } else if( key == "MemFree:" ) {
-            procMeminfo >> m_free;
-        } else if( key == "Buffers:" ) {
-            procMeminfo >> m_buffers;
-        } else if( key == "Cached:" ) {
-            procMeminfo >> m_cached;
+int Meminfo::parse(const char* buf, size_t)
+{
+    /* Run through meminfo, seeking the info we actually care about */
+    for(const char* line = buf; *line; line = nextLine(line)) {
+        /* Per-node lines are prefixed with "Node <id> " */
+        if( strncmp(line, "Node ", 5) == 0 ) {
+            long id;
+            line += 5;
+            parseLong(line, id);
+            while( *line == ' ' ) ++line;
         }
 
-        clearLine(procMeminfo);
+        if( parseField(line, "MemTotal:", m_total) ) continue;
+        if( parseField(line, "MemFree:", m_free) ) continue;
+        if( parseField(line, "Buffers:", m_buffers) ) continue;
+        if( parseField(line, "Cached:", m_cached) ) continue;
+        if( parseField(line, "FilePages:", m_cached) ) continue;
     }
 
+    if( m_total <= 0 ) {
+        cerr << "Failed to parse " << m_path << endl;
+        return -1;
+    }
     return 0;
 }
 
@@ -25,16 +25,30 @@
 
 #include <iostream>
 
-class Meminfo {
+#include "procsource.h"
+
+/* Memory utilization of the whole system, from /proc/meminfo, or of one
+ * NUMA node, from /sys/devices/system/node/node<id>/meminfo.  The per-node
+ * file has no Buffers or Cached lines; its FilePages count is used as 
+ * m_cached instead. */
+class Meminfo : public ProcSource {
 public:
     long m_total;
     long m_free;
     long m_buffers;
     long m_cached;
 
+private:
+    char m_path[64];
+
 public:
-    // Read current memory utilization data from /proc/meminfo 
-    int update();
+    // @param node  the kernel's NUMA node id, or -1 for the whole system
+    Meminfo(int node=-1);
+
+    const char* path() const
+        { return m_path; }
+    // Parse current memory utilization data from the meminfo file
+    int parse(const char* buf, size_t len);
 
     /* Fraction of memory currently in use.  
      * NB: We don't consider cache and buffer memory 'used' */
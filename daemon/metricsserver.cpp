@@ -0,0 +1,446 @@
+/******************************************************************************
+ * metricsserver.cpp
+ * Copyright 2026 agent
+ *
+ * Serves the daemon's current readings over a local Unix domain socket.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "metricsserver.h"
+#include "cpustat.h"
+#include "meminfo.h"
+#include "perfstat.h"
+
+// The socket is created mode 0660: owner and group only
+#define SOCKET_UMASK 0117
+
+// Ticks a client gets to read its whole response
+#define CLIENT_TIMEOUT 60
+
+// Initial text buffer size.  It grows to fit on the first few renders.
+#define TEXT_INITIAL_SIZE 4096
+
+static void fillCPU(MetricsCPU& out, const CPUUtilization& cpu)
+{
+    out.m_user = cpu.m_user;
+    out.m_nice = cpu.m_nice;
+    out.m_system = cpu.m_system;
+    out.m_idle = cpu.m_idle;
+    out.m_iowait = cpu.m_iowait;
+    out.m_irq = cpu.m_irq;
+    out.m_softirq = cpu.m_softirq;
+}
+
+/* Format a ratio for the text format.  Prometheus spells it NaN, printf 
+ * doesn't. */
+static const char* formatRatio(char* buf, size_t len, double val)
+{
+    if(isnan(val)) return "NaN";
+    snprintf(buf, len, "%.4f", val);
+    return buf;
+}
+
+MetricsServer::MetricsServer(const char* path, int maxClients) :
+    m_current(0),
+    m_tick(0),
+    m_path(path),
+    m_listenfd(-1)
+{
+    for(int i=0; i<SNAPSHOT_COUNT; ++i) {
+        m_snapshots[i].m_tick = 0;
+        m_snapshots[i].m_text.resize(TEXT_INITIAL_SIZE);
+        m_snapshots[i].m_textLen = 0;
+        memset(&m_snapshots[i].m_header, 0, sizeof(MetricsHeader));
+    }
+
+    Client unused;
+    unused.m_fd = -1;
+    unused.m_state = CLIENT_FREE;
+    unused.m_snapshot = 0;
+    unused.m_sent = 0;
+    unused.m_since = 0;
+    m_clients.assign(maxClients, unused);
+}
+
+MetricsServer::~MetricsServer()
+{
+    for(size_t i=0; i<m_clients.size(); ++i) {
+        dropClient(m_clients[i]);
+    }
+    if(m_listenfd >= 0) {
+        close(m_listenfd);
+        unlink(m_path);
+    }
+}
+
+int MetricsServer::open()
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(m_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", m_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, m_path);
+
+    m_listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(m_listenfd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    /* Clear out a stale socket from a previous run.  The daemon runs with
+     * umask 0, so bind under a tighter one; otherwise any local user could
+     * connect and use up every client slot. */
+    unlink(m_path);
+    mode_t oldMask = umask(SOCKET_UMASK);
+    int bound = bind(m_listenfd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(oldMask);
+    if(bound) {
+        perror("bind");
+        close(m_listenfd);
+        m_listenfd = -1;
+        return -1;
+    }
+    if( listen(m_listenfd, m_clients.size()) ) {
+        perror("listen");
+        close(m_listenfd);
+        m_listenfd = -1;
+        unlink(m_path);
+        return -1;
+    }
+    return 0;
+}
+
+void MetricsServer::appendText(Snapshot& snap, const char* fmt, ...)
+{
+    while(1) {
+        size_t room = snap.m_text.size() - snap.m_textLen;
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(&snap.m_text[snap.m_textLen], room, fmt, args);
+        va_end(args);
+        if(len < 0) return;
+        if((size_t)len < room) {
+            snap.m_textLen += len;
+            return;
+        }
+        snap.m_text.resize(snap.m_text.size() * 2);
+    }
+}
+
+void MetricsServer::renderText(Snapshot& snap, CPUStat& cpustat, 
+                               Meminfo& meminfo, PerfStat& perfstat, 
+                               bool blinkyOpen)
+{
+    char ratio[32];
+    snap.m_textLen = 0;
+
+    appendText(snap, "# HELP statusleds_cpu_utilization "
+                     "Fraction of non-idle time over the last tick.\n"
+                     "# TYPE statusleds_cpu_utilization gauge\n");
+    appendText(snap, "statusleds_cpu_utilization{cpu=\"all\"} %s\n", 
+               formatRatio(ratio, sizeof(ratio), 
+                           cpustat.totalDiff().getUtilization()));
+    for(int i=0; i<cpustat.cpuCount(); ++i) {
+        appendText(snap, "statusleds_cpu_utilization{cpu=\"%d\"} %s\n", i,
+                   formatRatio(ratio, sizeof(ratio),
+                               cpustat.cpuDiff(i).getUtilization()));
+    }
+
+    appendText(snap, "# HELP statusleds_memory_kilobytes Fields from /proc/meminfo.\n"
+                     "# TYPE statusleds_memory_kilobytes gauge\n"
+                     "statusleds_memory_kilobytes{field=\"total\"} %ld\n"
+                     "statusleds_memory_kilobytes{field=\"free\"} %ld\n"
+                     "statusleds_memory_kilobytes{field=\"buffers\"} %ld\n"
+                     "statusleds_memory_kilobytes{field=\"cached\"} %ld\n",
+               meminfo.m_total, meminfo.m_free, meminfo.m_buffers, 
+               meminfo.m_cached);
+    appendText(snap, "# HELP statusleds_memory_utilization "
+                     "Fraction of memory in use, excluding buffers and cache.\n"
+                     "# TYPE statusleds_memory_utilization gauge\n"
+                     "statusleds_memory_utilization %s\n",
+               formatRatio(ratio, sizeof(ratio), meminfo.getUtilization()));
+
+    if(perfstat.available()) {
+        PerfCounts& events = perfstat.totalDiff();
+        appendText(snap, "# HELP statusleds_tick_events "
+                         "Scheduler and VM events over the last tick.\n"
+                         "# TYPE statusleds_tick_events gauge\n"
+                         "statusleds_tick_events{event=\"context_switches\"} %ld\n"
+                         "statusleds_tick_events{event=\"migrations\"} %ld\n"
+                         "statusleds_tick_events{event=\"faults\"} %ld\n"
+                         "statusleds_tick_events{event=\"major_faults\"} %ld\n",
+                   events.m_contextSwitches, events.m_migrations,
+                   events.m_faults, events.m_majorFaults);
+    }
+
+    appendText(snap, "# HELP statusleds_blinky_up Whether the blinky device is open.\n"
+                     "# TYPE statusleds_blinky_up gauge\n"
+                     "statusleds_blinky_up %d\n"
+                     "# HELP statusleds_tick Number of ticks rendered.\n"
+                     "# TYPE statusleds_tick counter\n"
+                     "statusleds_tick %llu\n",
+               blinkyOpen ? 1 : 0, (unsigned long long)snap.m_tick);
+}
+
+void MetricsServer::render(CPUStat& cpustat, Meminfo& meminfo, 
+                           PerfStat& perfstat, bool blinkyOpen)
+{
+    if(m_listenfd < 0) return;
+
+    /* Anyone who hasn't sent a request within a tick isn't going to, and
+     * anyone who hasn't finished reading a response in CLIENT_TIMEOUT 
+     * ticks has stopped reading.  A close marks the end of a response, so 
+     * only those have theirs cut short. */
+    for(size_t i=0; i<m_clients.size(); ++i) {
+        Client& client = m_clients[i];
+        if(client.m_state == CLIENT_FREE) continue;
+        if( (client.m_state == CLIENT_REQUEST) && (client.m_since + 1 < m_tick) ) {
+            dropClient(client);
+        } else if( (client.m_state != CLIENT_REQUEST) && 
+                   (client.m_since + CLIENT_TIMEOUT < m_tick) ) {
+            dropClient(client);
+        }
+    }
+    ++m_tick;
+
+    /* Render into a snapshot nobody is reading.  If slow clients hold all
+     * of them, keep serving the current one for another tick. */
+    int target = -1;
+    for(int i=0; i<SNAPSHOT_COUNT; ++i) {
+        if( (i != m_current) && !isReading(i) ) {
+            target = i;
+            break;
+        }
+    }
+    if(target < 0) return;
+
+    Snapshot& snap = m_snapshots[target];
+    snap.m_tick = m_tick;
+
+    /* Binary format */
+    MetricsHeader& header = snap.m_header;
+    header.m_magic = METRICS_MAGIC;
+    header.m_version = METRICS_VERSION;
+    header.m_flags = 0;
+    if(blinkyOpen) header.m_flags |= METRICS_FLAG_BLINKY;
+    if(perfstat.available()) header.m_flags |= METRICS_FLAG_PERF;
+    header.m_tick = snap.m_tick;
+    header.m_cpuCount = cpustat.cpuCount();
+    fillCPU(header.m_total, cpustat.totalDiff());
+    header.m_memTotal = meminfo.m_total;
+    header.m_memFree = meminfo.m_free;
+    header.m_memBuffers = meminfo.m_buffers;
+    header.m_memCached = meminfo.m_cached;
+    if(perfstat.available()) {
+        PerfCounts& events = perfstat.totalDiff();
+        header.m_contextSwitches = events.m_contextSwitches;
+        header.m_migrations = events.m_migrations;
+        header.m_faults = events.m_faults;
+        header.m_majorFaults = events.m_majorFaults;
+    }
+    snap.m_cpus.resize(cpustat.cpuCount());
+    for(int i=0; i<cpustat.cpuCount(); ++i) {
+        fillCPU(snap.m_cpus[i], cpustat.cpuDiff(i));
+    }
+
+    renderText(snap, cpustat, meminfo, perfstat, blinkyOpen);
+
+    m_current = target;
+}
+
+int MetricsServer::fillPollfds(struct pollfd* fds)
+{
+    if(m_listenfd < 0) return 0;
+
+    int count = 0;
+    fds[count].fd = m_listenfd;
+    fds[count].events = POLLIN;
+    fds[count].revents = 0;
+    ++count;
+
+    for(size_t i=0; i<m_clients.size(); ++i) {
+        Client& client = m_clients[i];
+        if(client.m_state == CLIENT_FREE) continue;
+        fds[count].fd = client.m_fd;
+        fds[count].events = (client.m_state == CLIENT_REQUEST) ? POLLIN : POLLOUT;
+        fds[count].revents = 0;
+        ++count;
+    }
+    return count;
+}
+
+void MetricsServer::handlePollfds(struct pollfd* fds, int count)
+{
+    if(count < 1) return;
+
+    /* Clients were added to fds in order, so walk them in the same order */
+    int fdIdx = 1;
+    for(size_t i=0; (i<m_clients.size()) && (fdIdx<count); ++i) {
+        Client& client = m_clients[i];
+        if(client.m_fd != fds[fdIdx].fd) continue;
+        short revents = fds[fdIdx++].revents;
+        if(!revents) continue;
+
+        if(client.m_state == CLIENT_REQUEST) {
+            readRequest(client);
+        } else if(revents & (POLLERR | POLLHUP)) {
+            dropClient(client);
+        } else {
+            writeResponse(client);
+        }
+    }
+
+    if(fds[0].revents & POLLIN) {
+        acceptClients();
+    }
+}
+
+void MetricsServer::acceptClients()
+{
+    while(1) {
+        int fd = accept4(m_listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            if( (errno != EAGAIN) && (errno != EWOULDBLOCK) ) {
+                perror("accept");
+            }
+            return;
+        }
+
+        Client* slot = 0;
+        for(size_t i=0; i<m_clients.size(); ++i) {
+            if(m_clients[i].m_state == CLIENT_FREE) {
+                slot = &m_clients[i];
+                break;
+            }
+        }
+        if(!slot) {
+            // Too many clients.  They can try again.
+            close(fd);
+            continue;
+        }
+
+        slot->m_fd = fd;
+        slot->m_state = CLIENT_REQUEST;
+        slot->m_sent = 0;
+        slot->m_since = m_tick;
+    }
+}
+
+void MetricsServer::readRequest(Client& client)
+{
+    char buf[64];
+    ssize_t len = read(client.m_fd, buf, sizeof(buf));
+    if(len < 0) {
+        if( (errno == EAGAIN) || (errno == EWOULDBLOCK) ) return;
+        dropClient(client);
+        return;
+    }
+    if( (len == 0) || (m_tick == 0) ) {
+        // Hung up without asking, or we have nothing to send yet
+        dropClient(client);
+        return;
+    }
+
+    client.m_state = (buf[0] == 'B') ? CLIENT_BINARY : CLIENT_TEXT;
+    client.m_snapshot = m_current;
+    client.m_sent = 0;
+    // The socket is almost certainly writable already
+    writeResponse(client);
+}
+
+void MetricsServer::writeResponse(Client& client)
+{
+    Snapshot& snap = m_snapshots[client.m_snapshot];
+
+    /* Describe the whole response, then skip what's already been sent */
+    struct iovec iov[2];
+    int iovcnt;
+    if(client.m_state == CLIENT_TEXT) {
+        iov[0].iov_base = &snap.m_text[0];
+        iov[0].iov_len = snap.m_textLen;
+        iovcnt = 1;
+    } else {
+        iov[0].iov_base = &snap.m_header;
+        iov[0].iov_len = sizeof(MetricsHeader);
+        iov[1].iov_base = snap.m_cpus.empty() ? NULL : &snap.m_cpus[0];
+        iov[1].iov_len = snap.m_cpus.size() * sizeof(MetricsCPU);
+        iovcnt = 2;
+    }
+    struct iovec* pending = iov;
+    size_t skip = client.m_sent;
+    while( (iovcnt > 0) && (skip >= pending->iov_len) ) {
+        skip -= pending->iov_len;
+        ++pending;
+        --iovcnt;
+    }
+    if(iovcnt == 0) {
+        dropClient(client);
+        return;
+    }
+    pending->iov_base = (char*)pending->iov_base + skip;
+    pending->iov_len -= skip;
+
+    ssize_t len = writev(client.m_fd, pending, iovcnt);
+    if(len < 0) {
+        if( (errno == EAGAIN) || (errno == EWOULDBLOCK) ) return;
+        dropClient(client);
+        return;
+    }
+    client.m_sent += len;
+
+    size_t remaining = 0;
+    for(int i=0; i<iovcnt; ++i) remaining += pending[i].iov_len;
+    if((size_t)len >= remaining) {
+        // All sent.  Closing the connection marks the end of the response.
+        dropClient(client);
+    }
+}
+
+bool MetricsServer::isReading(int snapshot)
+{
+    for(size_t i=0; i<m_clients.size(); ++i) {
+        const Client& client = m_clients[i];
+        if( (client.m_state == CLIENT_TEXT || client.m_state == CLIENT_BINARY) &&
+            (client.m_snapshot == snapshot) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MetricsServer::dropClient(Client& client)
+{
+    if(client.m_fd >= 0) close(client.m_fd);
+    client.m_fd = -1;
+    client.m_state = CLIENT_FREE;
+}
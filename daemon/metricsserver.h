@@ -0,0 +1,156 @@
+/******************************************************************************
+ * metricsserver.h
+ * Copyright 2026 agent
+ *
+ * Serves the daemon's current readings over a local Unix domain socket.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef METRICSSERVER_H_
+#define METRICSSERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class CPUStat;
+class CPUUtilization;
+class Meminfo;
+class PerfStat;
+struct pollfd;
+
+#define METRICS_MAGIC 0x44454c53  // "SLED", little endian
+#define METRICS_VERSION 1
+
+/* Binary snapshot layout.  A binary response is one MetricsHeader followed
+ * by MetricsHeader::m_cpuCount MetricsCPU records, in host byte order. 
+ * Jiffy and event counts are deltas over the last tick. */
+struct MetricsCPU {
+    int64_t m_user;
+    int64_t m_nice;
+    int64_t m_system;
+    int64_t m_idle;
+    int64_t m_iowait;
+    int64_t m_irq;
+    int64_t m_softirq;
+};
+
+struct MetricsHeader {
+    uint32_t m_magic;
+    uint16_t m_version;
+    uint16_t m_flags;
+    uint64_t m_tick;
+    uint32_t m_cpuCount;
+    uint32_t m_reserved;
+    MetricsCPU m_total;
+    // Memory in kB, as in /proc/meminfo
+    int64_t m_memTotal;
+    int64_t m_memFree;
+    int64_t m_memBuffers;
+    int64_t m_memCached;
+    // Only meaningful if METRICS_FLAG_PERF is set
+    int64_t m_contextSwitches;
+    int64_t m_migrations;
+    int64_t m_faults;
+    int64_t m_majorFaults;
+};
+
+// Snapshots kept by MetricsServer
+#define SNAPSHOT_COUNT 3
+
+#define METRICS_FLAG_BLINKY 0x1  // Blinky device is open
+#define METRICS_FLAG_PERF   0x2  // perf_event counters are available
+
+/* Local metrics endpoint.
+ * A client connects, sends one request line, and gets the latest snapshot 
+ * back before the connection is closed.  A request starting with 'B' gets 
+ * the binary format; anything else gets Prometheus-style text.
+ *
+ * Both formats are rendered once per tick by render().  Every client is 
+ * served from those same buffers with non-blocking writev(), so scrapes 
+ * never cause extra /proc reads or formatting.  All sockets are 
+ * non-blocking and serviced from the daemon's poll() loop.  The socket is
+ * created mode 0660, so only the daemon's user and group can connect. */
+class MetricsServer {
+private:
+    // A rendered copy of both formats
+    struct Snapshot {
+        uint64_t m_tick;
+        std::vector<char> m_text;
+        size_t m_textLen;
+        MetricsHeader m_header;
+        std::vector<MetricsCPU> m_cpus;
+    };
+    /* render() never overwrites a snapshot which is still being sent, so
+     * a response is only ever cut short if its client stops reading 
+     * altogether.  With three, one slow client doesn't hold up renders. */
+    Snapshot m_snapshots[SNAPSHOT_COUNT];
+    int m_current;
+    uint64_t m_tick;
+
+    enum ClientState { CLIENT_FREE, CLIENT_REQUEST, CLIENT_TEXT, CLIENT_BINARY };
+    struct Client {
+        int m_fd;
+        ClientState m_state;
+        // Snapshot being sent, and how much has gone out
+        int m_snapshot;
+        size_t m_sent;
+        // The tick on which the client connected
+        uint64_t m_since;
+    };
+    std::vector<Client> m_clients;
+
+    const char* m_path;
+    int m_listenfd;
+
+    /* Append formatted text to a snapshot's text buffer, growing it if 
+     * needed.  Growth only happens while the buffer finds its size. */
+    void appendText(Snapshot& snap, const char* fmt, ...)
+        __attribute__((format(printf, 3, 4)));
+    void renderText(Snapshot& snap, CPUStat& cpustat, Meminfo& meminfo,
+                    PerfStat& perfstat, bool blinkyOpen);
+
+    void acceptClients();
+    void readRequest(Client& client);
+    void writeResponse(Client& client);
+    void dropClient(Client& client);
+    // Whether any client is still being sent this snapshot
+    bool isReading(int snapshot);
+
+public:
+    MetricsServer(const char* path, int maxClients=16);
+    ~MetricsServer();
+
+    /* Create and listen on the socket.
+     * @return 0 on success, -1 on failure */
+    int open();
+
+    // Render a new snapshot of the current readings
+    void render(CPUStat& cpustat, Meminfo& meminfo, PerfStat& perfstat,
+                bool blinkyOpen);
+
+    // Max number of pollfds fillPollfds() will use
+    int pollfdCount()
+        { return m_clients.size() + 1; }
+    /* Fill in pollfds for the listening socket and clients.
+     * @return the number of pollfds used */
+    int fillPollfds(struct pollfd* fds);
+    // Service whatever poll() reported on the pollfds from fillPollfds()
+    void handlePollfds(struct pollfd* fds, int count);
+};
+
+#endif // METRICSSERVER_H_
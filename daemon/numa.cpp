@@ -0,0 +1,105 @@
+/******************************************************************************
+ * numa.cpp
+ * Copyright 2026 agent
+ *
+ * Discovers which CPUs belong to which NUMA node, from /sys.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#include "numa.h"
+#include "main.h"
+
+using namespace std;
+
+#define NODE_DIR "/sys/devices/system/node"
+
+/* Parse a kernel cpulist ("0-3,8-11") and assign those cpus to node.
+ * @return 0 on success, -1 on a malformed list */
+static int parseCpuList(const char* list, int node, vector<int>& cpuNodes)
+{
+    const char* p = list;
+    while( (*p != '\0') && (*p != '\n') ) {
+        long first, last;
+        if( parseLong(p, first) ) return -1;
+        last = first;
+        if( *p == '-' ) {
+            ++p;
+            if( parseLong(p, last) ) return -1;
+        }
+        if( (first < 0) || (last < first) ) return -1;
+
+        if( (size_t)last >= cpuNodes.size() ) {
+            cpuNodes.resize(last + 1, -1);
+        }
+        for(long cpu=first; cpu<=last; ++cpu) {
+            cpuNodes[cpu] = node;
+        }
+
+        if( *p == ',' ) ++p;
+    }
+    return 0;
+}
+
+int NumaTopology::discover()
+{
+    m_nodeIds.clear();
+    m_cpuNodes.clear();
+
+    DIR* dir = opendir(NODE_DIR);
+    if(!dir) {
+        // No NUMA support in this kernel.  Not an error.
+        return 0;
+    }
+    struct dirent* entry;
+    while( (entry = readdir(dir)) ) {
+        int id;
+        char tail;
+        if( sscanf(entry->d_name, "node%d%c", &id, &tail) == 1 ) {
+            m_nodeIds.push_back(id);
+        }
+    }
+    closedir(dir);
+    sort(m_nodeIds.begin(), m_nodeIds.end());
+
+    for(size_t node=0; node<m_nodeIds.size(); ++node) {
+        char path[64];
+        snprintf(path, sizeof(path), NODE_DIR "/node%d/cpulist", m_nodeIds[node]);
+        FILE* file = fopen(path, "r");
+        if(!file) {
+            perror(path);
+            return -1;
+        }
+        char list[16384];
+        if( !fgets(list, sizeof(list), file) ) {
+            list[0] = '\0';  // A memory-only node
+        }
+        fclose(file);
+
+        if( parseCpuList(list, node, m_cpuNodes) ) {
+            cerr << "Can't parse " << path << endl;
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+ * numa.h
+ * Copyright 2026 agent
+ *
+ * Discovers which CPUs belong to which NUMA node, from /sys.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <vector>
+
+/* NUMA topology, read once at startup from /sys/devices/system/node.
+ * Nodes are referred to by index, [0,nodeCount()), which is the same as 
+ * the kernel's node id unless the ids have gaps. */
+class NumaTopology {
+private:
+    // Kernel node id of each node index
+    std::vector<int> m_nodeIds;
+    // Node index of each cpu id, or -1 if the cpu isn't in any node
+    std::vector<int> m_cpuNodes;
+
+public:
+    /* Read the topology.  On a kernel without NUMA support this finds no
+     * nodes, which isn't an error.
+     * @return  0 on success, -1 on failure */
+    int discover();
+
+    int nodeCount()
+        { return m_nodeIds.size(); }
+    // The kernel's id for a node index
+    int nodeId(int node)
+        { return m_nodeIds[node]; }
+    // Node index for each cpu id, -1 for cpus in no node
+    const std::vector<int>& cpuNodes()
+        { return m_cpuNodes; }
+};
+
+#endif // NUMA_H_
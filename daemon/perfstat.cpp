@@ -0,0 +1,201 @@
+/******************************************************************************
+ * perfstat.cpp
+ * Copyright 2026 agent
+ *
+ * Obtains context switch, migration and page fault counts from perf_event 
+ * software counters.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <iostream>
+
+#include "perfstat.h"
+
+using namespace std;
+
+/* The members of each counter group, in group order.  The leader is first. */
+static const uint64_t GROUP_EVENTS[] = {
+    PERF_COUNT_SW_CONTEXT_SWITCHES,
+    PERF_COUNT_SW_CPU_MIGRATIONS,
+    PERF_COUNT_SW_PAGE_FAULTS,
+    PERF_COUNT_SW_PAGE_FAULTS_MAJ,
+};
+#define GROUP_SIZE (sizeof(GROUP_EVENTS) / sizeof(GROUP_EVENTS[0]))
+
+/* Layout of a PERF_FORMAT_GROUP read */
+struct GroupRead {
+    uint64_t nr;
+    uint64_t values[GROUP_SIZE];
+};
+
+static int perf_event_open(struct perf_event_attr* attr, pid_t pid, int cpu,
+                           int groupfd, unsigned long flags)
+{
+    return syscall(__NR_perf_event_open, attr, pid, cpu, groupfd, flags);
+}
+
+PerfCounts::PerfCounts() :
+    m_contextSwitches(0),
+    m_migrations(0),
+    m_faults(0),
+    m_majorFaults(0)
+{ }
+
+PerfCounts PerfCounts::operator-(const PerfCounts& other)
+{
+    PerfCounts out ( *this );
+
+    out.m_contextSwitches -= other.m_contextSwitches;
+    out.m_migrations -= other.m_migrations;
+    out.m_faults -= other.m_faults;
+    out.m_majorFaults -= other.m_majorFaults;
+
+    return out;
+}
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other)
+{
+    m_contextSwitches += other.m_contextSwitches;
+    m_migrations += other.m_migrations;
+    m_faults += other.m_faults;
+    m_majorFaults += other.m_majorFaults;
+    return *this;
+}
+
+PerfStat::PerfStat() :
+    m_openCount(0)
+{ }
+
+PerfStat::~PerfStat()
+{
+    close();
+}
+
+int PerfStat::openGroup(int cpu)
+{
+    int leader = -1;
+    for(size_t i=0; i<GROUP_SIZE; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = GROUP_EVENTS[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        // Only the leader starts disabled; members follow it
+        attr.disabled = (leader < 0);
+
+        int fd = perf_event_open(&attr, -1, cpu, leader, PERF_FLAG_FD_CLOEXEC);
+        if(fd < 0) {
+            return -1;
+        }
+        m_fds.push_back(fd);
+        if(leader < 0) leader = fd;
+    }
+    return leader;
+}
+
+int PerfStat::open()
+{
+    close();
+
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if(cpus < 1) cpus = 1;
+
+    for(long cpu=0; cpu<cpus; ++cpu) {
+        int leader = openGroup(cpu);
+        if(leader < 0) {
+            if(errno == ENODEV) {
+                // Offline CPU.  Leave a hole so indices still match cpu ids.
+                m_leaderfds.push_back(-1);
+                continue;
+            }
+            if( (errno == EACCES) || (errno == EPERM) ) {
+                cerr << "perf_event_paranoid forbids system-wide counters; "
+                     << "context switch and fault counts disabled." << endl;
+            } else {
+                perror("perf_event_open");
+            }
+            close();
+            return -1;
+        }
+        m_leaderfds.push_back(leader);
+        ++m_openCount;
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    m_cpuTotals.assign(m_leaderfds.size(), PerfCounts());
+    m_cpuDiffs.assign(m_leaderfds.size(), PerfCounts());
+    m_allCPUTotal = PerfCounts();
+    m_allCPUDiff = PerfCounts();
+    return 0;
+}
+
+void PerfStat::close()
+{
+    for(size_t i=0; i<m_fds.size(); ++i) {
+        ::close(m_fds[i]);
+    }
+    m_fds.clear();
+    m_leaderfds.clear();
+    m_cpuTotals.clear();
+    m_cpuDiffs.clear();
+    m_openCount = 0;
+}
+
+int PerfStat::update()
+{
+    if( !available() ) return -1;
+
+    PerfCounts newTotal;
+    for(size_t i=0; i<m_leaderfds.size(); ++i) {
+        if(m_leaderfds[i] < 0) continue;
+
+        /* One read gets the whole group */
+        struct GroupRead group;
+        ssize_t len = read(m_leaderfds[i], &group, sizeof(group));
+        if(len < 0) {
+            perror("read perf group");
+            return -1;
+        }
+        if( (len != sizeof(group)) || (group.nr != GROUP_SIZE) ) {
+            cerr << "Short or malformed perf group read on cpu " << i << endl;
+            return -1;
+        }
+
+        PerfCounts cur;
+        cur.m_contextSwitches = group.values[0];
+        cur.m_migrations = group.values[1];
+        cur.m_faults = group.values[2];
+        cur.m_majorFaults = group.values[3];
+
+        m_cpuDiffs[i] = cur - m_cpuTotals[i];
+        m_cpuTotals[i] = cur;
+        newTotal += cur;
+    }
+
+    m_allCPUDiff = newTotal - m_allCPUTotal;
+    m_allCPUTotal = newTotal;
+    return 0;
+}
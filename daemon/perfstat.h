@@ -0,0 +1,111 @@
+/******************************************************************************
+ * perfstat.h
+ * Copyright 2026 agent
+ *
+ * Obtains context switch, migration and page fault counts from perf_event 
+ * software counters.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef PERFSTAT_H_
+#define PERFSTAT_H_
+
+#include <vector>
+
+/* Container for the software event counts we track.  Like CPUUtilization,
+ * this may hold totals since the counters were opened, or the deltas 
+ * between successive updates. */
+class PerfCounts {
+public:
+    long m_contextSwitches;
+    long m_migrations;
+    long m_faults;
+    long m_majorFaults;
+
+    PerfCounts();
+    PerfCounts operator-(const PerfCounts& other);
+    PerfCounts& operator+=(const PerfCounts& other);
+};
+
+/* Class for obtaining scheduler and VM event counts via perf_event_open().
+ * Only software events are used, so no hardware PMU access is needed, but
+ * counting system-wide still needs perf_event_paranoid <= 0 (or 
+ * CAP_PERFMON).  If that's not allowed, open() fails and the PerfStat
+ * simply stays unavailable.
+ *
+ * Each CPU gets one counter group, which is read with a single read(). */
+class PerfStat {
+private:
+    // The group leader fd for each CPU, or -1 if that CPU couldn't be opened
+    std::vector<int> m_leaderfds;
+    // Every counter fd, for closing
+    std::vector<int> m_fds;
+    // How many CPUs have a counter group open
+    int m_openCount;
+
+    // The total counts of all cpus since open()
+    PerfCounts m_allCPUTotal;
+    // The change in m_allCPUTotal between the last two updates
+    PerfCounts m_allCPUDiff;
+    // Per-CPU totals and diffs
+    std::vector<PerfCounts> m_cpuTotals;
+    std::vector<PerfCounts> m_cpuDiffs;
+
+    /* Open the counter group for one cpu.
+     * @return the leader fd, or -1 on failure (errno is set) */
+    int openGroup(int cpu);
+
+public:
+    PerfStat();
+    ~PerfStat();
+
+    /* Open counter groups on all CPUs.
+     * @return  0 on success, -1 if counters aren't available */
+    int open();
+    // Close all the counters.  The PerfStat is unavailable until reopened.
+    void close();
+    bool available()
+        { return !m_fds.empty(); }
+
+    /* Read all the counter groups.  Diffs are relative to the last update.
+     * @return  0 on success, -1 on failure */
+    int update();
+
+    /* Number of CPU indices, including the holes left for CPUs which were
+     * offline at open().  Those always read 0; divide by openCount() to get
+     * per-CPU figures. */
+    int cpuCount()
+        { return m_cpuTotals.size(); }
+    // Number of CPUs which are actually being counted
+    int openCount()
+        { return m_openCount; }
+
+    // Total counts of all CPUs since open()
+    PerfCounts& total()
+        { return m_allCPUTotal; }
+    // Change in total counts between last two updates
+    PerfCounts& totalDiff()
+        { return m_allCPUDiff; }
+    // Counts for a particular CPU since open()
+    PerfCounts& cpu(int cpu)
+        { return m_cpuTotals[cpu]; }
+    // Change in counts for a particular CPU between last two updates
+    PerfCounts& cpuDiff(int cpu)
+        { return m_cpuDiffs[cpu]; }
+};
+
+#endif // PERFSTAT_H_
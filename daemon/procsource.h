@@ -0,0 +1,46 @@
+/******************************************************************************
+ * procsource.h
+ * Copyright 2026 agent
+ *
+ * Interface for anything which is sampled by reading a /proc or /sys file.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef PROCSOURCE_H_
+#define PROCSOURCE_H_
+
+#include <stddef.h>
+
+/* A source of status information which is obtained by reading one file
+ * from the start on every tick.  Sources don't do their own IO; a Collector
+ * reads the file into a buffer and hands the contents to parse(). */
+class ProcSource {
+public:
+    virtual ~ProcSource() {}
+
+    // The file to be read
+    virtual const char* path() const = 0;
+    /* The largest read which is ever needed to see everything this source
+     * cares about.  Anything past this is silently truncated. */
+    virtual size_t bufferSize() const { return 4096; }
+    /* Parse one snapshot of the file.
+     * @param buf  the file contents, NUL terminated at buf[len]
+     * @return  0 on success, -1 on failure */
+    virtual int parse(const char* buf, size_t len) = 0;
+};
+
+#endif // PROCSOURCE_H_
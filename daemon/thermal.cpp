@@ -0,0 +1,309 @@
+/******************************************************************************
+ * thermal.cpp
+ * Copyright 2026 agent
+ *
+ * Obtains package temperatures and CPU clock speeds from hwmon, thermal 
+ * zones and cpufreq in /sys.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+
+#include "thermal.h"
+#include "collector.h"
+#include "main.h"
+
+using namespace std;
+
+// How close to its limit, in millidegrees, a package must be to throttle
+#define THROTTLE_MARGIN 5000
+// Below this fraction of max clock, a hot package counts as throttled
+#define THROTTLE_FREQ_RATIO 0.9
+
+// Highest tempN_* attribute index to look for on a hwmon device
+#define HWMON_MAX_TEMPS 64
+
+/* Read the first line of a small file.
+ * @return true on success */
+static bool readLine(const string& path, string& out)
+{
+    ifstream file(path.c_str());
+    return (bool)getline(file, out);
+}
+
+static bool readLong(const string& path, long& out)
+{
+    string line;
+    if( !readLine(path, line) ) return false;
+    const char* p = line.c_str();
+    return parseLong(p, out) == 0;
+}
+
+// Orders "hwmon2" before "hwmon10", given the length of the common prefix
+class NumberedLess {
+private:
+    size_t m_prefixLen;
+public:
+    NumberedLess(size_t prefixLen) : m_prefixLen(prefixLen) {}
+    bool operator()(const string& a, const string& b) const
+        { return atol(a.c_str() + m_prefixLen) < atol(b.c_str() + m_prefixLen); }
+};
+
+// Names in dir which start with prefix, in numerical order
+static vector<string> listDir(const string& dir, const char* prefix)
+{
+    vector<string> names;
+    DIR* d = opendir(dir.c_str());
+    if(!d) return names;
+    struct dirent* entry;
+    size_t prefixLen = strlen(prefix);
+    while( (entry = readdir(d)) ) {
+        if( strncmp(entry->d_name, prefix, prefixLen) == 0 ) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+
+    sort(names.begin(), names.end(), NumberedLess(prefixLen));
+    return names;
+}
+
+SysfsValue::SysfsValue(const string& path) :
+    m_path(path),
+    m_value(0)
+{ }
+
+int SysfsValue::parse(const char* buf, size_t)
+{
+    return parseLong(buf, m_value);
+}
+
+ThermalStat::~ThermalStat()
+{
+    for(size_t i=0; i<m_packages.size(); ++i) {
+        delete m_packages[i].m_temp;
+    }
+    for(size_t i=0; i<m_policies.size(); ++i) {
+        delete m_policies[i].m_curFreq;
+    }
+}
+
+ThermalStat::Package& ThermalStat::package(size_t index)
+{
+    if(index >= m_packages.size()) {
+        Package empty;
+        empty.m_temp = 0;
+        empty.m_maxTemp = 0;
+        empty.m_freqSum = 0;
+        empty.m_freqCount = 0;
+        m_packages.resize(index + 1, empty);
+    }
+    return m_packages[index];
+}
+
+int ThermalStat::discover()
+{
+    discoverHwmon();
+    bool haveSensors = false;
+    for(size_t i=0; i<m_packages.size(); ++i) {
+        if(m_packages[i].m_temp) haveSensors = true;
+    }
+    if(!haveSensors) {
+        discoverThermalZones();
+    }
+    discoverPolicies();
+    return m_packages.size();
+}
+
+void ThermalStat::discoverHwmon()
+{
+    /* Intel's coretemp labels its package sensors "Package id <n>".  AMD's
+     * k10temp has one device per package, each with a "Tctl" sensor. */
+    const string root = "/sys/class/hwmon";
+    vector<string> devices = listDir(root, "hwmon");
+    size_t amdPackages = 0;
+    for(size_t d=0; d<devices.size(); ++d) {
+        string dir = root + "/" + devices[d];
+        string name;
+        readLine(dir + "/name", name);
+
+        for(int t=1; t<=HWMON_MAX_TEMPS; ++t) {
+            char attr[32];
+            snprintf(attr, sizeof(attr), "/temp%d_", t);
+            string prefix = dir + attr;
+            string label;
+            if( !readLine(prefix + "label", label) ) continue;
+
+            size_t index;
+            if( label.compare(0, 11, "Package id ") == 0 ) {
+                index = atol(label.c_str() + 11);
+            } else if( (name == "k10temp") && (label == "Tctl") ) {
+                index = amdPackages++;
+            } else {
+                continue;
+            }
+
+            Package& pkg = package(index);
+            if(pkg.m_temp) continue;  // Already found
+            pkg.m_temp = new SysfsValue(prefix + "input");
+            if( !readLong(prefix + "max", pkg.m_maxTemp) &&
+                !readLong(prefix + "crit", pkg.m_maxTemp) ) {
+                pkg.m_maxTemp = 0;
+            }
+        }
+    }
+}
+
+void ThermalStat::discoverThermalZones()
+{
+    /* Fall back to the generic thermal zones, which on Intel include one
+     * per package */
+    const string root = "/sys/class/thermal";
+    vector<string> zones = listDir(root, "thermal_zone");
+    size_t index = 0;
+    for(size_t z=0; z<zones.size(); ++z) {
+        string dir = root + "/" + zones[z];
+        string type;
+        if( !readLine(dir + "/type", type) || (type != "x86_pkg_temp") ) {
+            continue;
+        }
+
+        Package& pkg = package(index++);
+        pkg.m_temp = new SysfsValue(dir + "/temp");
+
+        /* Use the passive trip point (where the kernel starts throttling), 
+         * or failing that the critical one */
+        long passive = 0, critical = 0;
+        for(int t=0; ; ++t) {
+            char attr[32];
+            snprintf(attr, sizeof(attr), "/trip_point_%d_", t);
+            string tripType;
+            long tripTemp;
+            if( !readLine(dir + attr + "type", tripType) ) break;
+            if( !readLong(dir + attr + "temp", tripTemp) ) continue;
+            if( (tripType == "passive") && (!passive || tripTemp < passive) ) {
+                passive = tripTemp;
+            } else if( tripType == "critical" ) {
+                critical = tripTemp;
+            }
+        }
+        pkg.m_maxTemp = passive ? passive : critical;
+    }
+}
+
+void ThermalStat::discoverPolicies()
+{
+    /* Policies are named for their first CPU, which tells us the package.
+     * All the CPUs in a policy share a clock, so one read covers them all. */
+    const string root = "/sys/devices/system/cpu/cpufreq";
+    vector<string> policies = listDir(root, "policy");
+    for(size_t p=0; p<policies.size(); ++p) {
+        string dir = root + "/" + policies[p];
+        Policy policy;
+        if( !readLong(dir + "/cpuinfo_max_freq", policy.m_maxFreq) ||
+            (policy.m_maxFreq <= 0) ) {
+            continue;
+        }
+
+        long cpu = atol(policies[p].c_str() + 6);
+        char topology[96];
+        snprintf(topology, sizeof(topology), 
+                 "/sys/devices/system/cpu/cpu%ld/topology/physical_package_id",
+                 cpu);
+        long pkg;
+        if( !readLong(topology, pkg) || (pkg < 0) ) pkg = 0;
+        policy.m_package = pkg;
+        package(pkg);
+
+        policy.m_curFreq = new SysfsValue(dir + "/scaling_cur_freq");
+        m_policies.push_back(policy);
+    }
+}
+
+void ThermalStat::addTo(Collector& collector)
+{
+    /* Anything which can't be opened is dropped, rather than reading as 0
+     * and making its package look cold or throttled */
+    for(size_t i=0; i<m_packages.size(); ++i) {
+        Package& pkg = m_packages[i];
+        if( pkg.m_temp && collector.add(pkg.m_temp) ) {
+            delete pkg.m_temp;
+            pkg.m_temp = 0;
+        }
+    }
+    for(size_t i=0; i<m_policies.size(); ) {
+        if( collector.add(m_policies[i].m_curFreq) ) {
+            delete m_policies[i].m_curFreq;
+            m_policies.erase(m_policies.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void ThermalStat::setEnabled(Collector& collector, bool enabled)
+{
+    for(size_t i=0; i<m_packages.size(); ++i) {
+        if(m_packages[i].m_temp) {
+            collector.setEnabled(m_packages[i].m_temp, enabled);
+        }
+    }
+    for(size_t i=0; i<m_policies.size(); ++i) {
+        collector.setEnabled(m_policies[i].m_curFreq, enabled);
+    }
+}
+
+void ThermalStat::update()
+{
+    for(size_t i=0; i<m_packages.size(); ++i) {
+        m_packages[i].m_freqSum = 0;
+        m_packages[i].m_freqCount = 0;
+    }
+    for(size_t i=0; i<m_policies.size(); ++i) {
+        Policy& policy = m_policies[i];
+        Package& pkg = m_packages[policy.m_package];
+        // Not read successfully yet
+        if(policy.m_curFreq->m_value <= 0) continue;
+        pkg.m_freqSum += (double)policy.m_curFreq->m_value / policy.m_maxFreq;
+        ++pkg.m_freqCount;
+    }
+}
+
+double ThermalStat::temp(int package)
+{
+    SysfsValue* sensor = m_packages[package].m_temp;
+    return sensor ? sensor->m_value / 1000.0 : 0;
+}
+
+double ThermalStat::freqRatio(int package)
+{
+    Package& pkg = m_packages[package];
+    return pkg.m_freqCount ? pkg.m_freqSum / pkg.m_freqCount : 1;
+}
+
+bool ThermalStat::throttled(int package)
+{
+    Package& pkg = m_packages[package];
+    if( !pkg.m_temp || (pkg.m_maxTemp <= 0) ) return false;
+    if( pkg.m_temp->m_value < pkg.m_maxTemp - THROTTLE_MARGIN ) return false;
+    return freqRatio(package) < THROTTLE_FREQ_RATIO;
+}
@@ -0,0 +1,112 @@
+/******************************************************************************
+ * thermal.h
+ * Copyright 2026 agent
+ *
+ * Obtains package temperatures and CPU clock speeds from hwmon, thermal 
+ * zones and cpufreq in /sys.
+ ******************************************************************************
+ * This program is distributed under the of the GNU Lesser Public License. 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *****************************************************************************/
+
+#ifndef THERMAL_H_
+#define THERMAL_H_
+
+#include <string>
+#include <vector>
+
+#include "procsource.h"
+
+class Collector;
+
+/* A sysfs attribute holding a single integer */
+class SysfsValue : public ProcSource {
+private:
+    std::string m_path;
+
+public:
+    long m_value;
+
+    SysfsValue(const std::string& path);
+
+    const char* path() const
+        { return m_path.c_str(); }
+    size_t bufferSize() const
+        { return 32; }
+    int parse(const char* buf, size_t len);
+};
+
+/* Class for obtaining per-package temperature and clock speed.
+ * Sensors and cpufreq policies are found once, by discover().  Their files
+ * are then read every tick by a Collector, so they stay open and are read
+ * together with everything else.  Only one file per cpufreq policy is 
+ * read, not one per CPU.
+ *
+ * A package counts as throttled when it's within a few degrees of its
+ * high temperature limit and isn't running at full clock. */
+class ThermalStat {
+private:
+    struct Package {
+        // Temperature sensor, in millidegrees C
+        SysfsValue* m_temp;
+        // The sensor's high limit, in millidegrees C, or 0 if unknown
+        long m_maxTemp;
+        // Sum of cur/max clock ratios for this package's policies, and count
+        double m_freqSum;
+        int m_freqCount;
+    };
+    std::vector<Package> m_packages;
+
+    struct Policy {
+        // scaling_cur_freq, in kHz
+        SysfsValue* m_curFreq;
+        // cpuinfo_max_freq, in kHz.  It doesn't change, so it's read once.
+        long m_maxFreq;
+        int m_package;
+    };
+    std::vector<Policy> m_policies;
+
+    // Sensors, in the order found
+    void discoverHwmon();
+    void discoverThermalZones();
+    void discoverPolicies();
+    // Get the package with the given index, creating it if needed
+    Package& package(size_t index);
+
+public:
+    ~ThermalStat();
+
+    /* Find the sensors and cpufreq policies.  Finding none isn't an error;
+     * many VMs have neither.
+     * @return the number of packages found */
+    int discover();
+    // Register every file with a collector, dropping any which won't open
+    void addTo(Collector& collector);
+    // Enable or disable reading every file
+    void setEnabled(Collector& collector, bool enabled);
+    // Compute per-package figures from the latest reads
+    void update();
+
+    int packageCount()
+        { return m_packages.size(); }
+    // Temperature of a package, in degrees C
+    double temp(int package);
+    /* Average ratio of current to maximum clock of a package's policies.
+     * 1 if there's no cpufreq information. */
+    double freqRatio(int package);
+    bool throttled(int package);
+};
+
+#endif // THERMAL_H_